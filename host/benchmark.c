@@ -0,0 +1,283 @@
+// micro-benchmarks for the per-frame code paths of the compass
+// measures the time per call on the host, compare runs before and after a change on the same machine
+//
+// usage: benchmark [name-filter] [iterations-factor]
+//
+// the sources are included directly to reach their static functions
+
+#include "pebble_host.h"
+
+#include "bitmap.c"
+#include "sensor_trace.c"
+#include "data_provider.c"
+#include "ticks_layer.c"
+#include "compass_calibration_window.c"
+#include "compass_window.c"
+
+#define BENCHMARK_DEFAULT_ITERATIONS 20000
+#define BENCHMARK_REPETITIONS 5
+
+typedef struct {
+    const char *name;
+    uint32_t iterations;
+    void (*setup)(void);
+    void (*run)(uint32_t iteration);
+    void (*teardown)(void);
+} Benchmark;
+
+static GContext *s_ctx;
+static volatile int32_t s_sink;
+
+// ---------------
+// data provider
+
+static DataProviderState *s_provider;
+
+static void setup_provider(void) {
+    s_provider = (DataProviderState *) data_provider_create(NULL, (DataProviderHandlers) {});
+    data_provider_set_target_angle((DataProvider *) s_provider, TRIG_MAX_ANGLE / 3);
+}
+
+static void teardown_provider(void) {
+    data_provider_destroy((DataProvider *) s_provider);
+    s_provider = NULL;
+}
+
+static void run_update_state(uint32_t iteration) {
+    // keep the needle moving, otherwise the physics converge and we measure the trivial case
+    if (iteration % 64 == 0) {
+        s_provider->target_angle = (s_provider->target_angle + TRIG_MAX_ANGLE / 3) % TRIG_MAX_ANGLE;
+    }
+    update_state(s_provider);
+    if (s_provider->timer) {
+        app_timer_cancel(s_provider->timer);
+        s_provider->timer = NULL;
+    }
+}
+
+// one callback of the accelerometer service with num_samples samples
+static void handle_accel_samples(uint32_t iteration, uint32_t num_samples) {
+    AccelData samples[DATA_PROVIDER_MAX_ACCEL_SAMPLES_PER_UPDATE];
+    for (uint32_t i = 0; i < num_samples; i++) {
+        const int16_t jitter = (int16_t) ((iteration * num_samples + i) % 16);
+        samples[i] = (AccelData) {.x = jitter, .y = (int16_t) (-600 + jitter), .z = (int16_t) (-800 - jitter)};
+    }
+    data_provider_handle_accel_data((DataProvider *) s_provider, samples, num_samples);
+    if (s_provider->timer) {
+        app_timer_cancel(s_provider->timer);
+        s_provider->timer = NULL;
+    }
+}
+
+static void run_handle_accel_data_single(uint32_t iteration) {
+    handle_accel_samples(iteration, 1);
+}
+
+static void run_handle_accel_data_batch(uint32_t iteration) {
+    handle_accel_samples(iteration, DATA_PROVIDER_DEFAULT_ACCEL_SAMPLES_PER_UPDATE);
+}
+
+// ---------------
+// ticks layer
+
+static TicksLayer *s_ticks_layer;
+
+static void setup_ticks_layer(float transition_factor) {
+    const GSize display = host_display_size();
+    s_ticks_layer = ticks_layer_create(GRect(0, 8, display.w, (int16_t) (display.h - 15)));
+    ticks_layer_set_angle(s_ticks_layer, TRIG_MAX_ANGLE / 7);
+    ticks_layer_set_transition_factor(s_ticks_layer, transition_factor);
+}
+
+static void setup_ticks_layer_rose(void) {
+    setup_ticks_layer(0);
+}
+
+static void setup_ticks_layer_transition(void) {
+    setup_ticks_layer(0.5f);
+}
+
+static void setup_ticks_layer_band(void) {
+    setup_ticks_layer(1);
+}
+
+static void teardown_ticks_layer(void) {
+    ticks_layer_destroy(s_ticks_layer);
+    s_ticks_layer = NULL;
+}
+
+static void run_point_from_center(uint32_t iteration) {
+    const TicksLayerTransform t = ticks_layer_transform(ticks_layer_get_ticks_data(s_ticks_layer),
+            layer_get_bounds(ticks_layer_get_layer(s_ticks_layer)));
+    const GPoint p = point_from_center(&t, (int32_t) (iteration * TRIG_MAX_ANGLE / 32), 60);
+    s_sink += p.x + p.y;
+}
+
+static void run_ticks_layer_update_proc(uint32_t iteration) {
+    ticks_layer_set_angle(s_ticks_layer, (int32_t) (iteration * 97));
+    ticks_layer_update_proc(ticks_layer_get_layer(s_ticks_layer), s_ctx);
+}
+
+// redraw without a change of angle, e.g. if another layer marked the window dirty
+static void run_ticks_layer_update_proc_unchanged(uint32_t iteration) {
+    ticks_layer_update_proc(ticks_layer_get_layer(s_ticks_layer), s_ctx);
+}
+
+// ---------------
+// calibration window
+
+static CompassCalibrationWindow *s_calibration_window;
+
+static void setup_calibration_window(void) {
+    s_calibration_window = compass_calibration_window_create();
+    window_stack_push(compass_calibration_window_get_window(s_calibration_window), false);
+
+    // worst case: every segment needs to be filled
+    for (int s = 0; s < CALIBRATION_MAX_SEGMENTS; s++) {
+        const int32_t angle = s * TRIG_MAX_ANGLE / CALIBRATION_MAX_SEGMENTS;
+        compass_calibration_window_merge_value(s_calibration_window, angle, (uint8_t) (s % 2 ? 255 : CALIBRATION_THRESHOLD_MID));
+    }
+}
+
+static void teardown_calibration_window(void) {
+    window_stack_pop_all(false);
+    compass_calibration_window_destroy(s_calibration_window);
+    s_calibration_window = NULL;
+}
+
+static void run_draw_indicator(uint32_t iteration) {
+    CompassCalibrationWindowData *data = window_get_user_data(compass_calibration_window_get_window(s_calibration_window));
+    draw_indicator(data->indicator_layer, s_ctx);
+}
+
+// typical frame while calibrating: one segment reaches its next level, the rest of the ring is cached
+static void run_draw_indicator_one_segment(uint32_t iteration) {
+    static const uint8_t levels[] = {CALIBRATION_THRESHOLD_VISITED, CALIBRATION_THRESHOLD_MID, CALIBRATION_THRESHOLD_FILLED};
+    CompassCalibrationWindowData *data = window_get_user_data(compass_calibration_window_get_window(s_calibration_window));
+    const uint32_t step = iteration % (CALIBRATION_MAX_SEGMENTS * ARRAY_LENGTH(levels));
+    if (step == 0) {
+        reset_segment_data(data, false);
+    }
+    const int32_t angle = (int32_t) (step % CALIBRATION_MAX_SEGMENTS) * TRIG_MAX_ANGLE / CALIBRATION_MAX_SEGMENTS;
+    compass_calibration_window_merge_value(s_calibration_window, angle, levels[step / CALIBRATION_MAX_SEGMENTS]);
+    draw_indicator(data->indicator_layer, s_ctx);
+}
+
+// called for every accelerometer sample, most samples don't change the ring
+static void run_apply_accel_data(uint32_t iteration) {
+    const int32_t angle = (int32_t) (iteration * 97 % TRIG_MAX_ANGLE);
+    const AccelData accel_data = {
+        .x = (int16_t) (cos_lookup(angle) * 500 / TRIG_MAX_RATIO),
+        .y = (int16_t) (sin_lookup(angle) * 500 / TRIG_MAX_RATIO),
+        .z = (int16_t) (iteration % 1000),
+    };
+    compass_calibration_window_apply_accel_data(s_calibration_window, accel_data);
+}
+
+static void run_fill_quads(uint32_t iteration) {
+    // one segment of the calibration ring
+    const int16_t d = (int16_t) (iteration % 16);
+    const CompassCalibrationWindowQuad quad = {{
+        GPoint(60 + d, 20),
+        GPoint(62 + d, 10),
+        GPoint(71 + d, 11),
+        GPoint(68 + d, 21),
+    }};
+    fill_quads(s_ctx, &quad, 1, (GRect){.size = host_display_size()});
+}
+
+// ---------------
+// compass window
+
+static CompassWindow *s_compass_window;
+
+static void setup_compass_window(void) {
+    s_compass_window = compass_window_create();
+    window_stack_push(compass_window_get_window(s_compass_window), false);
+    // places the pointer and the cross hairs
+    compass_layer_update_layout(window_get_user_data(compass_window_get_window(s_compass_window)), DataProviderChangeAll);
+}
+
+static void teardown_compass_window(void) {
+    window_stack_pop_all(false);
+    compass_window_destroy(s_compass_window);
+    s_compass_window = NULL;
+}
+
+static void run_pointer_layer_update(uint32_t iteration) {
+    CompassWindowData *data = window_get_user_data(compass_window_get_window(s_compass_window));
+    pointer_layer_update(data->pointer_layer, s_ctx);
+}
+
+static void run_small_cross_hair_layer_update(uint32_t iteration) {
+    CompassWindowData *data = window_get_user_data(compass_window_get_window(s_compass_window));
+    small_cross_hair_layer_update(data->small_cross_hair_layer, s_ctx);
+}
+
+// ---------------
+// runner
+
+static const Benchmark s_benchmarks[] = {
+    {"update_state", 200000, setup_provider, run_update_state, teardown_provider},
+    {"handle_accel_data/1", 200000, setup_provider, run_handle_accel_data_single, teardown_provider},
+    {"handle_accel_data/batch", 200000, setup_provider, run_handle_accel_data_batch, teardown_provider},
+    {"point_from_center", 200000, setup_ticks_layer_transition, run_point_from_center, teardown_ticks_layer},
+    {"ticks_layer_update_proc/rose", BENCHMARK_DEFAULT_ITERATIONS, setup_ticks_layer_rose, run_ticks_layer_update_proc, teardown_ticks_layer},
+    {"ticks_layer_update_proc/transition", BENCHMARK_DEFAULT_ITERATIONS, setup_ticks_layer_transition, run_ticks_layer_update_proc, teardown_ticks_layer},
+    {"ticks_layer_update_proc/band", BENCHMARK_DEFAULT_ITERATIONS, setup_ticks_layer_band, run_ticks_layer_update_proc, teardown_ticks_layer},
+    {"ticks_layer_update_proc/unchanged", BENCHMARK_DEFAULT_ITERATIONS, setup_ticks_layer_rose, run_ticks_layer_update_proc_unchanged, teardown_ticks_layer},
+    {"draw_indicator", BENCHMARK_DEFAULT_ITERATIONS, setup_calibration_window, run_draw_indicator, teardown_calibration_window},
+    {"draw_indicator/one_segment", BENCHMARK_DEFAULT_ITERATIONS, setup_calibration_window, run_draw_indicator_one_segment, teardown_calibration_window},
+    {"apply_accel_data", 200000, setup_calibration_window, run_apply_accel_data, teardown_calibration_window},
+    {"fill_quads", 200000, NULL, run_fill_quads, NULL},
+    {"pointer_layer_update", 200000, setup_compass_window, run_pointer_layer_update, teardown_compass_window},
+    {"small_cross_hair_layer_update", 200000, setup_compass_window, run_small_cross_hair_layer_update, teardown_compass_window},
+};
+
+static void run_benchmark(const Benchmark *benchmark, uint32_t iterations) {
+    if (benchmark->setup) benchmark->setup();
+
+    // warm up caches and lazily initialized tables
+    for (uint32_t i = 0; i < iterations / 10 + 1; i++) {
+        benchmark->run(i);
+    }
+
+    // best of several runs, filters out noise from other processes
+    uint64_t elapsed = UINT64_MAX;
+    HostGraphicsStats stats = {};
+    for (int r = 0; r < BENCHMARK_REPETITIONS; r++) {
+        host_graphics_context_reset_stats(s_ctx);
+        const uint64_t start = host_clock_ns();
+        for (uint32_t i = 0; i < iterations; i++) {
+            benchmark->run(i);
+        }
+        const uint64_t run_elapsed = host_clock_ns() - start;
+        if (run_elapsed < elapsed) {
+            elapsed = run_elapsed;
+        }
+        stats = host_graphics_context_get_stats(s_ctx);
+    }
+
+    if (benchmark->teardown) benchmark->teardown();
+
+    printf("%-40s %10u %12.1f %12.1f\n", benchmark->name, iterations,
+           (double) elapsed / iterations, (double) stats.draw_calls / iterations);
+}
+
+int main(int argc, char **argv) {
+    const char *filter = argc > 1 ? argv[1] : NULL;
+    const double factor = argc > 2 ? atof(argv[2]) : 1;
+
+    s_ctx = host_graphics_context_create();
+
+    printf("%-40s %10s %12s %12s\n", "benchmark", "calls", "ns/call", "draws/call");
+    for (uint32_t i = 0; i < ARRAY_LENGTH(s_benchmarks); i++) {
+        const Benchmark *benchmark = &s_benchmarks[i];
+        if (filter && !strstr(benchmark->name, filter)) continue;
+        const uint32_t iterations = (uint32_t) (benchmark->iterations * factor) + 1;
+        run_benchmark(benchmark, iterations);
+    }
+
+    host_graphics_context_destroy(s_ctx);
+    return 0;
+}
@@ -0,0 +1,1004 @@
+// stand-in for geometry, trigonometry, bitmaps and graphics of the Pebble SDK
+// drawing primitives rasterize into a real frame buffer of the platform's format and count their calls and pixels,
+// a count-only context just counts the calls
+
+#include <math.h>
+#include <pthread.h>
+#include "pebble_host.h"
+
+#define MIN(X, Y) ((X) < (Y) ? (X) : (Y))
+#define MAX(X, Y) ((X) > (Y) ? (X) : (Y))
+
+// ---------------
+// math
+
+// quarter wave table, like the firmware's lookup tables this keeps sin_lookup() cheap and deterministic
+#define HOST_TRIG_TABLE_SIZE (TRIG_MAX_ANGLE / 4 + 1)
+static int32_t s_sin_table[HOST_TRIG_TABLE_SIZE];
+// shared by all threads, filled once
+static pthread_once_t s_sin_table_once = PTHREAD_ONCE_INIT;
+
+static void init_sin_table(void) {
+    for (int i = 0; i < HOST_TRIG_TABLE_SIZE; i++) {
+        s_sin_table[i] = (int32_t) lround(sin(i * 2 * M_PI / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO);
+    }
+}
+
+int32_t sin_lookup(int32_t angle) {
+    pthread_once(&s_sin_table_once, init_sin_table);
+    angle &= TRIG_MAX_ANGLE - 1;
+    const int32_t quarter = TRIG_MAX_ANGLE / 4;
+    if (angle < quarter) return s_sin_table[angle];
+    if (angle < 2 * quarter) return s_sin_table[2 * quarter - angle];
+    if (angle < 3 * quarter) return -s_sin_table[angle - 2 * quarter];
+    return -s_sin_table[TRIG_MAX_ANGLE - angle];
+}
+
+int32_t cos_lookup(int32_t angle) {
+    return sin_lookup(angle + TRIG_MAX_ANGLE / 4);
+}
+
+int32_t atan2_lookup(int16_t y, int16_t x) {
+    int32_t result = (int32_t) lround(atan2(y, x) * TRIG_MAX_ANGLE / (2 * M_PI));
+    return (result + TRIG_MAX_ANGLE) % TRIG_MAX_ANGLE;
+}
+
+// ---------------
+// geometry
+
+bool gpoint_equal(const GPoint * const point_a, const GPoint * const point_b) {
+    return point_a->x == point_b->x && point_a->y == point_b->y;
+}
+
+bool gsize_equal(const GSize *size_a, const GSize *size_b) {
+    return size_a->w == size_b->w && size_a->h == size_b->h;
+}
+
+bool grect_equal(const GRect * const rect_a, const GRect * const rect_b) {
+    return gpoint_equal(&rect_a->origin, &rect_b->origin) && gsize_equal(&rect_a->size, &rect_b->size);
+}
+
+bool grect_contains_point(const GRect *rect, const GPoint *point) {
+    return point->x >= rect->origin.x && point->x < rect->origin.x + rect->size.w &&
+           point->y >= rect->origin.y && point->y < rect->origin.y + rect->size.h;
+}
+
+GPoint grect_center_point(const GRect *rect) {
+    return GPoint((int16_t)(rect->origin.x + rect->size.w / 2), (int16_t)(rect->origin.y + rect->size.h / 2));
+}
+
+GRect grect_crop(GRect rect, const int32_t crop_size_px) {
+    return GRect((int16_t)(rect.origin.x + crop_size_px), (int16_t)(rect.origin.y + crop_size_px),
+                 (int16_t)(rect.size.w - 2 * crop_size_px), (int16_t)(rect.size.h - 2 * crop_size_px));
+}
+
+static GRect grect_intersection(GRect a, GRect b) {
+    const int16_t x0 = MAX(a.origin.x, b.origin.x);
+    const int16_t y0 = MAX(a.origin.y, b.origin.y);
+    const int16_t x1 = MIN(a.origin.x + a.size.w, b.origin.x + b.size.w);
+    const int16_t y1 = MIN(a.origin.y + a.size.h, b.origin.y + b.size.h);
+    return GRect(x0, y0, (int16_t) MAX(0, x1 - x0), (int16_t) MAX(0, y1 - y0));
+}
+
+void grect_align(GRect *rect, const GRect *inside_rect, const GAlign alignment, const bool clip) {
+    const int16_t left = inside_rect->origin.x;
+    const int16_t top = inside_rect->origin.y;
+    const int16_t right = inside_rect->origin.x + inside_rect->size.w - rect->size.w;
+    const int16_t bottom = inside_rect->origin.y + inside_rect->size.h - rect->size.h;
+    const int16_t center_x = inside_rect->origin.x + (inside_rect->size.w - rect->size.w) / 2;
+    const int16_t center_y = inside_rect->origin.y + (inside_rect->size.h - rect->size.h) / 2;
+
+    switch (alignment) {
+        case GAlignCenter:      rect->origin = GPoint(center_x, center_y); break;
+        case GAlignTopLeft:     rect->origin = GPoint(left, top); break;
+        case GAlignTopRight:    rect->origin = GPoint(right, top); break;
+        case GAlignTop:         rect->origin = GPoint(center_x, top); break;
+        case GAlignLeft:        rect->origin = GPoint(left, center_y); break;
+        case GAlignBottom:      rect->origin = GPoint(center_x, bottom); break;
+        case GAlignRight:       rect->origin = GPoint(right, center_y); break;
+        case GAlignBottomRight: rect->origin = GPoint(right, bottom); break;
+        case GAlignBottomLeft:  rect->origin = GPoint(left, bottom); break;
+    }
+
+    if (clip) {
+        *rect = grect_intersection(*rect, *inside_rect);
+    }
+}
+
+bool gcolor_equal(GColor8 x, GColor8 y) {
+    return x.argb == y.argb || (x.a == 0 && y.a == 0);
+}
+
+// ---------------
+// bitmaps
+
+struct GBitmap {
+    uint8_t *addr;
+    uint16_t row_size_bytes;
+    GBitmapFormat format;
+    GRect bounds;
+    GColor *palette;
+    bool free_data;
+    bool free_palette;
+};
+
+static uint8_t bits_per_pixel(GBitmapFormat format) {
+    switch (format) {
+        case GBitmapFormat1Bit:
+        case GBitmapFormat1BitPalette:
+            return 1;
+        case GBitmapFormat2BitPalette:
+            return 2;
+        case GBitmapFormat4BitPalette:
+            return 4;
+        case GBitmapFormat8Bit:
+        case GBitmapFormat8BitCircular:
+            return 8;
+    }
+    return 8;
+}
+
+static uint8_t palette_size(GBitmapFormat format) {
+    switch (format) {
+        case GBitmapFormat1BitPalette: return 2;
+        case GBitmapFormat2BitPalette: return 4;
+        case GBitmapFormat4BitPalette: return 16;
+        default: return 0;
+    }
+}
+
+static uint16_t row_size_bytes(GSize size, GBitmapFormat format) {
+    if (format == GBitmapFormat1Bit) {
+        // 1-bit rows are word aligned
+        return (uint16_t) (((size.w + 31) / 32) * 4);
+    }
+    return (uint16_t) ((size.w * bits_per_pixel(format) + 7) / 8);
+}
+
+GBitmap *gbitmap_create_blank_with_palette(GSize size, GBitmapFormat format, GColor *palette, bool free_on_destroy) {
+    GBitmap *result = calloc(1, sizeof(GBitmap));
+    result->format = format;
+    result->bounds = (GRect){.size = size};
+    result->row_size_bytes = row_size_bytes(size, format);
+    result->addr = calloc(size.h, result->row_size_bytes);
+    result->free_data = true;
+    result->palette = palette;
+    result->free_palette = palette && free_on_destroy;
+    return result;
+}
+
+GBitmap *gbitmap_create_blank(GSize size, GBitmapFormat format) {
+    GColor *palette = NULL;
+    if (palette_size(format) > 0) {
+        palette = calloc(palette_size(format), sizeof(GColor));
+    }
+    return gbitmap_create_blank_with_palette(size, format, palette, true);
+}
+
+GBitmap *gbitmap_create_as_sub_bitmap(const GBitmap *base_bitmap, GRect sub_rect) {
+    GBitmap *result = calloc(1, sizeof(GBitmap));
+    *result = *base_bitmap;
+    result->bounds = grect_intersection(sub_rect, base_bitmap->bounds);
+    result->free_data = false;
+    result->free_palette = false;
+    return result;
+}
+
+void gbitmap_destroy(GBitmap *bitmap) {
+    if (!bitmap) return;
+    if (bitmap->free_data) free(bitmap->addr);
+    if (bitmap->free_palette) free(bitmap->palette);
+    free(bitmap);
+}
+
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap) {
+    return bitmap->row_size_bytes;
+}
+
+GBitmapFormat gbitmap_get_format(const GBitmap *bitmap) {
+    return bitmap->format;
+}
+
+uint8_t *gbitmap_get_data(const GBitmap *bitmap) {
+    return bitmap->addr;
+}
+
+GRect gbitmap_get_bounds(const GBitmap *bitmap) {
+    return bitmap->bounds;
+}
+
+void gbitmap_set_bounds(GBitmap *bitmap, GRect bounds) {
+    bitmap->bounds = bounds;
+}
+
+GColor *gbitmap_get_palette(const GBitmap *bitmap) {
+    return bitmap->palette;
+}
+
+void gbitmap_set_palette(GBitmap *bitmap, GColor *palette, bool free_on_destroy) {
+    if (bitmap->free_palette) free(bitmap->palette);
+    bitmap->palette = palette;
+    bitmap->free_palette = free_on_destroy;
+}
+
+// chalk's frame buffer only stores the pixels inside of the circular display
+static void circular_row_range(int16_t diameter, uint16_t y, int16_t *min_x, int16_t *max_x) {
+    const int32_t r = diameter / 2;
+    const int32_t dy = 2 * (int32_t) y + 1 - diameter;
+    const int32_t dx = (int32_t) sqrt((double) (4 * r * r - dy * dy)) / 2;
+    *min_x = (int16_t) MAX(0, r - dx);
+    *max_x = (int16_t) MIN(diameter - 1, r + dx - 1);
+}
+
+GBitmapDataRowInfo gbitmap_get_data_row_info(const GBitmap *bitmap, uint16_t y) {
+    GBitmapDataRowInfo result = {
+        .data = bitmap->addr + y * bitmap->row_size_bytes,
+        .min_x = bitmap->bounds.origin.x,
+        .max_x = (int16_t) (bitmap->bounds.origin.x + bitmap->bounds.size.w - 1),
+    };
+    if (bitmap->format == GBitmapFormat8BitCircular) {
+        circular_row_range((int16_t) bitmap->row_size_bytes, y, &result.min_x, &result.max_x);
+    }
+    return result;
+}
+
+// ---------------
+// resources
+
+// the app's resources are simple cross hairs, recreate them instead of decoding the PNGs
+// their formats follow the "memoryFormat" of the resources in appinfo.json
+static void set_resource_pixel(GBitmap *bitmap, int x, int y) {
+    uint8_t *row = bitmap->addr + y * bitmap->row_size_bytes;
+    switch (bitmap->format) {
+        case GBitmapFormat1Bit:
+            row[x / 8] |= 1 << (x % 8);
+            break;
+        case GBitmapFormat1BitPalette:
+        case GBitmapFormat2BitPalette:
+        case GBitmapFormat4BitPalette: {
+            // palette index 1, leftmost pixel in the most significant bits
+            const int bits_per_pixel = palette_size(bitmap->format) == 2 ? 1 : palette_size(bitmap->format) == 4 ? 2 : 4;
+            const int pixels_per_byte = 8 / bits_per_pixel;
+            row[x / pixels_per_byte] |= 1 << (8 - bits_per_pixel * (x % pixels_per_byte + 1));
+            break;
+        }
+        default:
+            row[x] = GColorWhiteARGB8;
+            break;
+    }
+}
+
+static GBitmap *create_cross_hair(int16_t size, int16_t gap, GBitmapFormat format) {
+    GBitmap *result = gbitmap_create_blank(GSize(size, size), format);
+    if (result->palette) {
+        // unused entries of larger palettes stay GColorClear
+        result->palette[0] = GColorClear;
+        result->palette[1] = GColorWhite;
+    }
+    const int16_t c = size / 2;
+    for (int16_t i = 0; i < size; i++) {
+        if (abs(i - c) <= gap) continue;
+        set_resource_pixel(result, c, i);
+        set_resource_pixel(result, i, c);
+    }
+    if (gap < 0) {
+        set_resource_pixel(result, c, c);
+    }
+    return result;
+}
+
+GBitmap *gbitmap_create_with_resource(uint32_t resource_id) {
+    switch (resource_id) {
+        case RESOURCE_ID_CROSS_HAIR_SMALL:
+            return create_cross_hair(17, -1, PBL_IF_COLOR_ELSE(GBitmapFormat2BitPalette, GBitmapFormat1Bit));
+        case RESOURCE_ID_CROSS_HAIR_LARGE:
+            return create_cross_hair(43, 1, PBL_IF_COLOR_ELSE(GBitmapFormat2BitPalette, GBitmapFormat1Bit));
+        case RESOURCE_ID_ICON:
+            return gbitmap_create_blank(GSize(25, 25), PBL_IF_COLOR_ELSE(GBitmapFormat8Bit, GBitmapFormat1Bit));
+        default:
+            return NULL;
+    }
+}
+
+// ---------------
+// display
+
+GSize host_display_size(void) {
+    return PBL_IF_ROUND_ELSE(GSize(180, 180), GSize(144, 168));
+}
+
+GBitmapFormat host_display_format(void) {
+#if defined(PBL_ROUND)
+    return GBitmapFormat8BitCircular;
+#elif defined(PBL_COLOR)
+    return GBitmapFormat8Bit;
+#else
+    return GBitmapFormat1Bit;
+#endif
+}
+
+// ---------------
+// graphics context
+
+struct GContext {
+    GBitmap *frame_buffer;
+    // visible part of each row of the frame buffer, all of it unless the display is round
+    GBitmapDataRowInfo *rows;
+    bool frame_buffer_captured;
+    GRect drawing_box;
+    GColor stroke_color;
+    GColor fill_color;
+    GColor text_color;
+    GCompOp compositing_mode;
+    // drawing primitives leave the frame buffer alone, captures still work
+    bool count_only;
+    HostGraphicsStats stats;
+};
+
+GContext *host_graphics_context_create(void) {
+    GContext *result = calloc(1, sizeof(GContext));
+    const GSize size = host_display_size();
+    result->frame_buffer = gbitmap_create_blank(size, host_display_format());
+    result->rows = calloc(size.h, sizeof(GBitmapDataRowInfo));
+    for (int16_t y = 0; y < size.h; y++) {
+        result->rows[y] = gbitmap_get_data_row_info(result->frame_buffer, (uint16_t) y);
+    }
+    result->drawing_box = (GRect){.size = size};
+    result->stroke_color = GColorBlack;
+    result->fill_color = GColorBlack;
+    result->text_color = GColorWhite;
+    return result;
+}
+
+void host_graphics_context_destroy(GContext *ctx) {
+    if (!ctx) return;
+    gbitmap_destroy(ctx->frame_buffer);
+    free(ctx->rows);
+    free(ctx);
+}
+
+GBitmap *host_graphics_context_get_frame_buffer(GContext *ctx) {
+    return ctx->frame_buffer;
+}
+
+void host_graphics_context_set_drawing_box(GContext *ctx, GRect drawing_box) {
+    ctx->drawing_box = drawing_box;
+}
+
+void host_graphics_context_set_count_only(GContext *ctx, bool count_only) {
+    ctx->count_only = count_only;
+}
+
+HostGraphicsStats host_graphics_context_get_stats(GContext *ctx) {
+    return ctx->stats;
+}
+
+void host_graphics_context_reset_stats(GContext *ctx) {
+    ctx->stats = (HostGraphicsStats){};
+}
+
+void host_graphics_context_get_rgb(GContext *ctx, uint8_t *rgb) {
+    const GBitmap *frame_buffer = ctx->frame_buffer;
+    const GSize size = frame_buffer->bounds.size;
+    for (int16_t y = 0; y < size.h; y++) {
+        const GBitmapDataRowInfo row = ctx->rows[y];
+        for (int16_t x = 0; x < size.w; x++) {
+            uint8_t *pixel = rgb + (y * size.w + x) * 3;
+            if (x < row.min_x || x > row.max_x) {
+                pixel[0] = pixel[1] = pixel[2] = 0;
+            } else if (frame_buffer->format == GBitmapFormat1Bit) {
+                pixel[0] = pixel[1] = pixel[2] = (row.data[x / 8] >> (x % 8)) & 1 ? 255 : 0;
+            } else {
+                const GColor color = (GColor){.argb = row.data[x]};
+                pixel[0] = (uint8_t) (color.r * 85);
+                pixel[1] = (uint8_t) (color.g * 85);
+                pixel[2] = (uint8_t) (color.b * 85);
+            }
+        }
+    }
+}
+
+bool host_graphics_context_write_ppm(GContext *ctx, const char *path) {
+    const GSize size = ctx->frame_buffer->bounds.size;
+    uint8_t *rgb = malloc(size.w * size.h * 3);
+    host_graphics_context_get_rgb(ctx, rgb);
+
+    FILE *file = fopen(path, "wb");
+    bool result = file != NULL;
+    if (file) {
+        fprintf(file, "P6\n%d %d\n255\n", size.w, size.h);
+        result = fwrite(rgb, 3, size.w * size.h, file) == (size_t) (size.w * size.h);
+        result = fclose(file) == 0 && result;
+    }
+    free(rgb);
+    return result;
+}
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color) {
+    ctx->stroke_color = color;
+}
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color) {
+    ctx->fill_color = color;
+}
+
+void graphics_context_set_text_color(GContext *ctx, GColor color) {
+    ctx->text_color = color;
+}
+
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode) {
+    ctx->compositing_mode = mode;
+}
+
+GBitmap *graphics_capture_frame_buffer(GContext *ctx) {
+    if (ctx->frame_buffer_captured) {
+        return NULL;
+    }
+    ctx->frame_buffer_captured = true;
+    ctx->stats.frame_buffer_captures++;
+    return ctx->frame_buffer;
+}
+
+GBitmap *graphics_capture_frame_buffer_format(GContext *ctx, GBitmapFormat format) {
+    if (format != ctx->frame_buffer->format) {
+        return NULL;
+    }
+    return graphics_capture_frame_buffer(ctx);
+}
+
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer) {
+    if (!ctx->frame_buffer_captured || buffer != ctx->frame_buffer) {
+        return false;
+    }
+    ctx->frame_buffer_captured = false;
+    return true;
+}
+
+// ---------------
+// rasterizer
+
+// aplite only has black and white, light gray and white become white
+static bool is_light(GColor color) {
+    return color.r + color.g + color.b >= 6;
+}
+
+// fills x0...x1 of row y, both inclusive and relative to the drawing box, clipped to the drawing box and the display
+static void fill_span(GContext *ctx, int32_t y, int32_t x0, int32_t x1, GColor color) {
+    if (color.a == 0) return;
+
+    const GRect box = ctx->drawing_box;
+    y += box.origin.y;
+    if (y < MAX(box.origin.y, 0) || y >= MIN(box.origin.y + box.size.h, ctx->frame_buffer->bounds.size.h)) return;
+    const GBitmapDataRowInfo row = ctx->rows[y];
+    x0 = MAX(x0 + box.origin.x, MAX(box.origin.x, row.min_x));
+    x1 = MIN(x1 + box.origin.x, MIN(box.origin.x + box.size.w - 1, row.max_x));
+    if (x1 < x0) return;
+
+    ctx->stats.pixel_writes += (uint32_t) (x1 - x0 + 1);
+    if (ctx->frame_buffer->format == GBitmapFormat1Bit) {
+        // partial bytes at both ends bit by bit, whole bytes in between
+        const bool white = is_light(color);
+        for (int32_t x = x0; x <= x1; x++) {
+            if (x % 8 == 0 && x + 7 <= x1) {
+                row.data[x / 8] = white ? 0xff : 0;
+                x += 7;
+            } else if (white) {
+                row.data[x / 8] |= (uint8_t) (1 << (x % 8));
+            } else {
+                row.data[x / 8] &= (uint8_t) ~(1 << (x % 8));
+            }
+        }
+    } else {
+        // partial transparency isn't blended, the frame buffer is always opaque
+        memset(row.data + x0, color.argb | 0xc0, (size_t) (x1 - x0 + 1));
+    }
+}
+
+static void plot(GContext *ctx, int32_t x, int32_t y, GColor color) {
+    fill_span(ctx, y, x, x, color);
+}
+
+// color of a pixel of bitmap in any format, x and y are relative to its data
+static GColor get_pixel(const GBitmap *bitmap, int32_t x, int32_t y) {
+    const uint8_t *row = bitmap->addr + y * bitmap->row_size_bytes;
+    switch (bitmap->format) {
+        case GBitmapFormat1Bit:
+            return (row[x / 8] >> (x % 8)) & 1 ? GColorWhite : GColorBlack;
+        case GBitmapFormat8Bit:
+        case GBitmapFormat8BitCircular:
+            return (GColor){.argb = row[x]};
+        default: {
+            const int bits = bits_per_pixel(bitmap->format);
+            const int pixels_per_byte = 8 / bits;
+            const int index = (row[x / pixels_per_byte] >> (8 - bits * (x % pixels_per_byte + 1))) & ((1 << bits) - 1);
+            return bitmap->palette ? bitmap->palette[index] : GColorClear;
+        }
+    }
+}
+
+// combines a pixel of a bitmap with the frame buffer, as documented for GCompOp
+static void composite_pixel(GContext *ctx, int32_t x, int32_t y, GColor color) {
+    switch (ctx->compositing_mode) {
+        case GCompOpAssign:
+            plot(ctx, x, y, (GColor){.argb = (uint8_t) (color.argb | 0xc0)});
+            break;
+        case GCompOpAssignInverted:
+            plot(ctx, x, y, (GColor){.argb = (uint8_t) (~color.argb | 0xc0)});
+            break;
+        case GCompOpOr:
+            if (is_light(color)) plot(ctx, x, y, GColorWhite);
+            break;
+        case GCompOpAnd:
+            if (!is_light(color)) plot(ctx, x, y, GColorBlack);
+            break;
+        case GCompOpClear:
+            if (is_light(color)) plot(ctx, x, y, GColorBlack);
+            break;
+        case GCompOpSet:
+#if defined(PBL_COLOR)
+            // the transparency mode on color displays
+            plot(ctx, x, y, color);
+#else
+            if (!is_light(color)) plot(ctx, x, y, GColorWhite);
+#endif
+            break;
+    }
+}
+
+// ---------------
+// drawing primitives
+
+// counts the call, false if the primitive must not rasterize
+static bool begin_draw_call(GContext *ctx) {
+    ctx->stats.draw_calls++;
+    return !ctx->count_only;
+}
+
+void graphics_draw_pixel(GContext *ctx, GPoint point) {
+    if (!begin_draw_call(ctx)) return;
+    plot(ctx, point.x, point.y, ctx->stroke_color);
+}
+
+// bresenham, both end points included
+static void draw_line(GContext *ctx, GPoint p0, GPoint p1) {
+    if (p0.y == p1.y) {
+        fill_span(ctx, p0.y, MIN(p0.x, p1.x), MAX(p0.x, p1.x), ctx->stroke_color);
+        return;
+    }
+    const int32_t dx = abs(p1.x - p0.x);
+    const int32_t dy = -abs(p1.y - p0.y);
+    const int32_t step_x = p0.x < p1.x ? 1 : -1;
+    const int32_t step_y = p0.y < p1.y ? 1 : -1;
+    int32_t error = dx + dy;
+    int32_t x = p0.x;
+    int32_t y = p0.y;
+    for (;;) {
+        plot(ctx, x, y, ctx->stroke_color);
+        if (x == p1.x && y == p1.y) break;
+        const int32_t e2 = 2 * error;
+        if (e2 >= dy) {
+            error += dy;
+            x += step_x;
+        }
+        if (e2 <= dx) {
+            error += dx;
+            y += step_y;
+        }
+    }
+}
+
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1) {
+    if (!begin_draw_call(ctx)) return;
+    draw_line(ctx, p0, p1);
+}
+
+void graphics_draw_rect(GContext *ctx, GRect rect) {
+    if (!begin_draw_call(ctx)) return;
+    if (rect.size.w <= 0 || rect.size.h <= 0) return;
+    const int32_t x1 = rect.origin.x + rect.size.w - 1;
+    const int32_t y1 = rect.origin.y + rect.size.h - 1;
+    fill_span(ctx, rect.origin.y, rect.origin.x, x1, ctx->stroke_color);
+    fill_span(ctx, y1, rect.origin.x, x1, ctx->stroke_color);
+    for (int32_t y = rect.origin.y + 1; y < y1; y++) {
+        plot(ctx, rect.origin.x, y, ctx->stroke_color);
+        plot(ctx, x1, y, ctx->stroke_color);
+    }
+}
+
+// how far row dy of a rounded corner with radius is indented, dy counts from the outermost row
+static int32_t corner_inset(int32_t radius, int32_t dy) {
+    const double d = radius - dy - 0.5;
+    return radius - (int32_t) lround(sqrt(radius * radius - d * d));
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask) {
+    if (!begin_draw_call(ctx)) return;
+    if (rect.size.w <= 0 || rect.size.h <= 0) return;
+    const int32_t radius = corner_mask ? MIN(corner_radius, MIN(rect.size.w, rect.size.h) / 2) : 0;
+    for (int32_t dy = 0; dy < rect.size.h; dy++) {
+        int32_t left = 0;
+        int32_t right = 0;
+        if (dy < radius) {
+            const int32_t inset = corner_inset(radius, dy);
+            left = corner_mask & GCornerTopLeft ? inset : 0;
+            right = corner_mask & GCornerTopRight ? inset : 0;
+        } else if (rect.size.h - 1 - dy < radius) {
+            const int32_t inset = corner_inset(radius, rect.size.h - 1 - dy);
+            left = corner_mask & GCornerBottomLeft ? inset : 0;
+            right = corner_mask & GCornerBottomRight ? inset : 0;
+        }
+        fill_span(ctx, rect.origin.y + dy, rect.origin.x + left, rect.origin.x + rect.size.w - 1 - right, ctx->fill_color);
+    }
+}
+
+// midpoint circle
+void graphics_draw_circle(GContext *ctx, GPoint p, uint16_t radius) {
+    if (!begin_draw_call(ctx)) return;
+    int32_t x = radius;
+    int32_t y = 0;
+    int32_t error = 1 - x;
+    while (x >= y) {
+        const int32_t octants[8][2] = {{x, y}, {y, x}, {-y, x}, {-x, y}, {-x, -y}, {-y, -x}, {y, -x}, {x, -y}};
+        for (int i = 0; i < 8; i++) {
+            plot(ctx, p.x + octants[i][0], p.y + octants[i][1], ctx->stroke_color);
+        }
+        y++;
+        if (error < 0) {
+            error += 2 * y + 1;
+        } else {
+            x--;
+            error += 2 * (y - x) + 1;
+        }
+    }
+}
+
+void graphics_fill_circle(GContext *ctx, GPoint p, uint16_t radius) {
+    if (!begin_draw_call(ctx)) return;
+    const int32_t r = radius;
+    for (int32_t dy = -r; dy <= r; dy++) {
+        const int32_t dx = (int32_t) sqrt((double) (r * r - dy * dy) + 0.5);
+        fill_span(ctx, p.y + dy, p.x - dx, p.x + dx, ctx->fill_color);
+    }
+}
+
+// the bitmap repeats if rect is larger than the bitmap
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect) {
+    if (!begin_draw_call(ctx)) return;
+    const GRect bounds = bitmap->bounds;
+    if (bounds.size.w <= 0 || bounds.size.h <= 0) return;
+    for (int32_t dy = 0; dy < rect.size.h; dy++) {
+        for (int32_t dx = 0; dx < rect.size.w; dx++) {
+            const GColor color = get_pixel(bitmap, bounds.origin.x + dx % bounds.size.w, bounds.origin.y + dy % bounds.size.h);
+            composite_pixel(ctx, rect.origin.x + dx, rect.origin.y + dy, color);
+        }
+    }
+}
+
+// rotates src clockwise around src_ic and draws it so that src_ic ends up at dest_ic
+// each destination pixel samples the source pixel its position maps back to, no filtering
+void graphics_draw_rotated_bitmap(GContext *ctx, GBitmap *src, GPoint src_ic, int rotation, GPoint dest_ic) {
+    if (!begin_draw_call(ctx)) return;
+    const GRect bounds = src->bounds;
+    const int32_t sine = sin_lookup(rotation);
+    const int32_t cosine = cos_lookup(rotation);
+
+    // the rotated bitmap stays within the circle through its farthest corner
+    int32_t radius = 0;
+    for (int i = 0; i < 4; i++) {
+        const int32_t cx = (i & 1 ? bounds.origin.x + bounds.size.w : bounds.origin.x) - src_ic.x;
+        const int32_t cy = (i & 2 ? bounds.origin.y + bounds.size.h : bounds.origin.y) - src_ic.y;
+        radius = MAX(radius, (int32_t) ceil(sqrt((double) (cx * cx + cy * cy))));
+    }
+
+    for (int32_t dy = -radius; dy <= radius; dy++) {
+        for (int32_t dx = -radius; dx <= radius; dx++) {
+            const int64_t u = (int64_t) dx * cosine + (int64_t) dy * sine;
+            const int64_t v = (int64_t) dy * cosine - (int64_t) dx * sine;
+            // rounded to the nearest pixel, floor division for negative values
+            const int32_t sx = src_ic.x + (int32_t) ((u + TRIG_MAX_RATIO / 2 + ((int64_t) TRIG_MAX_RATIO << 16)) / TRIG_MAX_RATIO - (1 << 16));
+            const int32_t sy = src_ic.y + (int32_t) ((v + TRIG_MAX_RATIO / 2 + ((int64_t) TRIG_MAX_RATIO << 16)) / TRIG_MAX_RATIO - (1 << 16));
+            if (sx < bounds.origin.x || sx >= bounds.origin.x + bounds.size.w ||
+                sy < bounds.origin.y || sy >= bounds.origin.y + bounds.size.h) {
+                continue;
+            }
+            composite_pixel(ctx, dest_ic.x + dx, dest_ic.y + dy, get_pixel(src, sx, sy));
+        }
+    }
+}
+
+// ---------------
+// paths
+
+GPath *gpath_create(const GPathInfo *init) {
+    GPath *result = calloc(1, sizeof(GPath));
+    result->num_points = init->num_points;
+    result->points = init->points;
+    return result;
+}
+
+void gpath_destroy(GPath *gpath) {
+    free(gpath);
+}
+
+// like the firmware, points rotate around the origin before they move by the offset
+static GPoint gpath_point(const GPath *path, uint32_t i) {
+    const GPoint p = path->points[i];
+    const int32_t sine = sin_lookup(path->rotation);
+    const int32_t cosine = cos_lookup(path->rotation);
+    return GPoint((int16_t) ((p.x * cosine - p.y * sine) / TRIG_MAX_RATIO + path->offset.x),
+                  (int16_t) ((p.x * sine + p.y * cosine) / TRIG_MAX_RATIO + path->offset.y));
+}
+
+static int direction(GPoint from, GPoint to) {
+    return to.y > from.y ? 1 : (to.y < from.y ? -1 : 0);
+}
+
+// edges interpolate from their first point and round halves away from zero, rows are inclusive at both ends
+// unless the previous edge continues in the same direction, then they share the row of the vertex
+// spans between the crossings of a row follow the non-zero winding rule, see fill_quads() of the calibration window
+void gpath_draw_filled(GContext *ctx, GPath *path) {
+    if (!begin_draw_call(ctx)) return;
+    const uint32_t n = path->num_points;
+    if (n < 2) return;
+
+    GPoint points[n];
+    int32_t top = INT16_MAX;
+    int32_t bottom = INT16_MIN;
+    for (uint32_t i = 0; i < n; i++) {
+        points[i] = gpath_point(path, i);
+        top = MIN(top, points[i].y);
+        bottom = MAX(bottom, points[i].y);
+    }
+
+    int32_t crossings[n];
+    int8_t windings[n];
+    for (int32_t y = top; y <= bottom; y++) {
+        uint32_t num_crossings = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            const GPoint from = points[i];
+            const GPoint to = points[(i + 1) % n];
+            const int dir = direction(from, to);
+            if (dir == 0) continue;
+
+            int prev_dir = 0;
+            for (uint32_t k = 1; k < n && prev_dir == 0; k++) {
+                prev_dir = direction(points[(i + n - k) % n], points[(i + n - k + 1) % n]);
+            }
+            int32_t y_top = MIN(from.y, to.y);
+            int32_t y_bottom = MAX(from.y, to.y);
+            if (prev_dir == dir) {
+                if (dir > 0) y_top++; else y_bottom--;
+            }
+            if (y < y_top || y > y_bottom) continue;
+
+            const int32_t dx = abs(to.x - from.x);
+            const int32_t dy = abs(to.y - from.y);
+            const int32_t x = from.x + (to.x < from.x ? -1 : 1) * ((dx * abs(y - from.y) + dy / 2) / dy);
+
+            // insertion sort by x
+            uint32_t j = num_crossings++;
+            for (; j > 0 && crossings[j - 1] > x; j--) {
+                crossings[j] = crossings[j - 1];
+                windings[j] = windings[j - 1];
+            }
+            crossings[j] = x;
+            windings[j] = (int8_t) dir;
+        }
+
+        int winding = 0;
+        int32_t span_start = 0;
+        for (uint32_t i = 0; i < num_crossings; i++) {
+            if (winding == 0) {
+                span_start = crossings[i];
+            }
+            winding += windings[i];
+            if (winding == 0) {
+                fill_span(ctx, y, span_start, crossings[i], ctx->fill_color);
+            }
+        }
+    }
+}
+
+void gpath_draw_outline(GContext *ctx, GPath *path) {
+    if (!begin_draw_call(ctx)) return;
+    for (uint32_t i = 0; i < path->num_points; i++) {
+        draw_line(ctx, gpath_point(path, i), gpath_point(path, (i + 1) % path->num_points));
+    }
+}
+
+void gpath_rotate_to(GPath *path, int32_t angle) {
+    path->rotation = angle;
+}
+
+void gpath_move_to(GPath *path, GPoint point) {
+    path->offset = point;
+}
+
+// ---------------
+// fonts and text
+
+struct FontInfo {
+    const char *key;
+    int16_t glyph_width;
+    int16_t line_height;
+};
+
+static struct FontInfo s_fonts[] = {
+    {FONT_KEY_GOTHIC_18, 6, 18},
+    {FONT_KEY_GOTHIC_18_BOLD, 9, 18},
+    {FONT_KEY_GOTHIC_24_BOLD, 12, 24},
+};
+
+// 5x7 glyphs instead of the system fonts, rows from top to bottom, the most significant of 5 bits is the leftmost pixel
+// lower case letters use the upper case glyphs, anything else without a glyph is drawn as a box
+#define HOST_GLYPH_WIDTH 5
+#define HOST_GLYPH_HEIGHT 7
+#define HOST_GLYPH_DEGREE '\x01'
+
+typedef struct {
+    char character;
+    uint8_t rows[HOST_GLYPH_HEIGHT];
+} HostGlyph;
+
+static const HostGlyph s_glyphs[] = {
+    {'0', {0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e}},
+    {'1', {0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e}},
+    {'2', {0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f}},
+    {'3', {0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e}},
+    {'4', {0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02}},
+    {'5', {0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e}},
+    {'6', {0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e}},
+    {'7', {0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}},
+    {'8', {0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e}},
+    {'9', {0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c}},
+    {'A', {0x0e, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11}},
+    {'B', {0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e}},
+    {'C', {0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e}},
+    {'D', {0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c}},
+    {'E', {0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f}},
+    {'F', {0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10}},
+    {'G', {0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f}},
+    {'H', {0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11}},
+    {'I', {0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e}},
+    {'J', {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c}},
+    {'K', {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}},
+    {'L', {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f}},
+    {'M', {0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11}},
+    {'N', {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}},
+    {'O', {0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e}},
+    {'P', {0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10}},
+    {'Q', {0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d}},
+    {'R', {0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11}},
+    {'S', {0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e}},
+    {'T', {0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}},
+    {'U', {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e}},
+    {'V', {0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04}},
+    {'W', {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a}},
+    {'X', {0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11}},
+    {'Y', {0x11, 0x11, 0x11, 0x0a, 0x04, 0x04, 0x04}},
+    {'Z', {0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f}},
+    {' ', {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+    {'!', {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04}},
+    {'?', {0x0e, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04}},
+    {'.', {0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c}},
+    {',', {0x00, 0x00, 0x00, 0x00, 0x0c, 0x04, 0x08}},
+    {'-', {0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00}},
+    {'\'', {0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00}},
+    {'/', {0x01, 0x01, 0x02, 0x04, 0x08, 0x10, 0x10}},
+    {':', {0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00}},
+    {'%', {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}},
+    {HOST_GLYPH_DEGREE, {0x0c, 0x12, 0x12, 0x0c, 0x00, 0x00, 0x00}},
+};
+
+static const HostGlyph s_missing_glyph = {'\0', {0x1f, 0x11, 0x11, 0x11, 0x11, 0x11, 0x1f}};
+
+GFont fonts_get_system_font(const char *font_key) {
+    for (uint32_t i = 0; i < ARRAY_LENGTH(s_fonts); i++) {
+        if (strcmp(s_fonts[i].key, font_key) == 0) {
+            return &s_fonts[i];
+        }
+    }
+    return &s_fonts[0];
+}
+
+// decodes the character at *text and moves past it, returns the glyph to draw for it
+static const HostGlyph *next_glyph(const char **text) {
+    char character = **text;
+    (*text)++;
+    if ((character & 0xc0) == 0xc0) {
+        // UTF-8 sequence, only ° has a glyph
+        const bool degree = (uint8_t) character == 0xc2 && (uint8_t) **text == 0xb0;
+        while ((**text & 0xc0) == 0x80) {
+            (*text)++;
+        }
+        if (!degree) return &s_missing_glyph;
+        character = HOST_GLYPH_DEGREE;
+    } else if (character >= 'a' && character <= 'z') {
+        character = (char) (character - 'a' + 'A');
+    }
+    for (uint32_t i = 0; i < ARRAY_LENGTH(s_glyphs); i++) {
+        if (s_glyphs[i].character == character) {
+            return &s_glyphs[i];
+        }
+    }
+    return &s_missing_glyph;
+}
+
+// breaks the line that starts at text at '\n' and, with GTextOverflowModeWordWrap, after the last space that fits into width
+// returns the number of characters of the line, *next is where the next line starts
+static int16_t layout_line(const char *text, GFont const font, int16_t width, GTextOverflowMode overflow_mode, const char **next) {
+    int16_t columns = 0;
+    int16_t columns_before_space = -1;
+    const char *c = text;
+    for (; *c && *c != '\n'; c++) {
+        if ((*c & 0xC0) == 0x80) continue;
+        if (overflow_mode == GTextOverflowModeWordWrap && columns_before_space >= 0 && (columns + 1) * font->glyph_width > width) {
+            *next = text;
+            for (int16_t i = 0; i <= columns_before_space; i++) {
+                next_glyph(next);
+            }
+            return columns_before_space;
+        }
+        if (*c == ' ') {
+            columns_before_space = columns;
+        }
+        columns++;
+    }
+    *next = *c == '\n' ? c + 1 : c;
+    return columns;
+}
+
+GSize graphics_text_layout_get_content_size(const char *text, GFont const font, const GRect box,
+        const GTextOverflowMode overflow_mode, const GTextAlignment alignment) {
+    // monospaced approximation, good enough for layouting
+    int16_t lines = 0;
+    int16_t max_columns = 0;
+    const char *c = text;
+    do {
+        const int16_t columns = layout_line(c, font, box.size.w, overflow_mode, &c);
+        max_columns = MAX(max_columns, columns);
+        lines++;
+    } while (*c);
+    return GSize((int16_t) MIN(box.size.w, max_columns * font->glyph_width),
+                 (int16_t) MIN(box.size.h, lines * font->line_height));
+}
+
+// whatever doesn't fit into box is clipped
+void graphics_draw_text(GContext *ctx, const char *text, GFont const font, const GRect box,
+        const GTextOverflowMode overflow_mode, const GTextAlignment alignment, GTextAttributes *text_attributes) {
+    if (!begin_draw_call(ctx)) return;
+    const int32_t scale = font->line_height >= 24 ? 2 : 1;
+    const int32_t glyph_x = (font->glyph_width - HOST_GLYPH_WIDTH * scale) / 2;
+    const int32_t glyph_y = (font->line_height - HOST_GLYPH_HEIGHT * scale) / 2;
+    const int32_t box_right = box.origin.x + box.size.w - 1;
+    const int32_t box_bottom = box.origin.y + box.size.h - 1;
+
+    int32_t line_y = box.origin.y;
+    const char *c = text;
+    while (*c && line_y <= box_bottom) {
+        const char *next;
+        const int16_t columns = layout_line(c, font, box.size.w, overflow_mode, &next);
+        const int32_t width = columns * font->glyph_width;
+        int32_t x = alignment == GTextAlignmentLeft ? box.origin.x :
+                    alignment == GTextAlignmentCenter ? box.origin.x + (box.size.w - width) / 2 :
+                    box_right + 1 - width;
+
+        for (int16_t i = 0; i < columns; i++) {
+            const HostGlyph *glyph = next_glyph(&c);
+            for (int32_t row = 0; row < HOST_GLYPH_HEIGHT * scale; row++) {
+                const int32_t y = line_y + glyph_y + row;
+                if (y < box.origin.y || y > box_bottom) continue;
+                const uint8_t bits = glyph->rows[row / scale];
+                for (int32_t column = 0; column < HOST_GLYPH_WIDTH * scale; column++) {
+                    const int32_t px = x + glyph_x + column;
+                    if (bits & (0x10 >> (column / scale)) && px >= box.origin.x && px <= box_right) {
+                        plot(ctx, px, y, ctx->text_color);
+                    }
+                }
+            }
+            x += font->glyph_width;
+        }
+        c = next;
+        line_y += font->line_height;
+    }
+}
@@ -0,0 +1,143 @@
+// host specific extensions of the pebble.h stand-in
+// used by the host tools to drive the app's code without a watch
+
+#pragma once
+
+#include "pebble.h"
+
+// ---------------
+// display
+
+//! size of the display of the platform the stand-in was compiled for
+GSize host_display_size(void);
+
+//! format of the frame buffer, GBitmapFormat1Bit on aplite, GBitmapFormat8BitCircular on chalk
+GBitmapFormat host_display_format(void);
+
+// ---------------
+// graphics
+
+typedef struct {
+    uint32_t draw_calls;
+    // written by the drawing primitives, direct access to a captured frame buffer isn't counted
+    uint32_t pixel_writes;
+    uint32_t frame_buffer_captures;
+} HostGraphicsStats;
+
+//! creates a graphics context that draws into a frame buffer of the current platform
+GContext *host_graphics_context_create(void);
+void host_graphics_context_destroy(GContext *ctx);
+
+//! direct access to the frame buffer, unlike graphics_capture_frame_buffer() this never fails
+GBitmap *host_graphics_context_get_frame_buffer(GContext *ctx);
+
+//! translates and clips all drawing operations, the layer renderer uses this for each layer
+void host_graphics_context_set_drawing_box(GContext *ctx, GRect drawing_box);
+
+//! count_only makes drawing primitives count their calls without rasterizing, which keeps simulations fast,
+//! pixel writes stay 0 and the frame buffer only holds what the app wrote into a captured one
+void host_graphics_context_set_count_only(GContext *ctx, bool count_only);
+
+HostGraphicsStats host_graphics_context_get_stats(GContext *ctx);
+void host_graphics_context_reset_stats(GContext *ctx);
+
+//! converts the frame buffer to RGB, 3 bytes per pixel and row by row, pixels outside of a round display are black
+void host_graphics_context_get_rgb(GContext *ctx, uint8_t *rgb);
+
+//! writes the frame buffer as binary PPM, returns false if that failed
+bool host_graphics_context_write_ppm(GContext *ctx, const char *path);
+
+// ---------------
+// layers and windows
+
+//! calls the update procs of layer and all of its visible children, in the same order as the firmware does
+void host_layer_render(Layer *layer, GContext *ctx);
+
+//! fills the frame buffer with the window's background color and renders its layer hierarchy
+void host_window_render(Window *window, GContext *ctx);
+
+//! calls the handler the top window registered for a single click on button_id
+void host_window_stack_click(ButtonId button_id);
+
+//! true if a layer was marked dirty or a window appeared since the last host_window_render()
+bool host_display_needs_render(void);
+
+// ---------------
+// event loop
+
+// timers, animation frames and posted callbacks run from one queue in virtual time
+// entries that are due at the same time run in order of posting, just like the firmware's event queue
+// the queue, the services and the window stack are per thread, each thread runs its own session
+
+typedef void (*HostEventCallback)(void *data);
+
+typedef struct {
+    uint32_t num_timers_fired;
+    uint32_t num_animation_frames;
+    uint32_t num_callbacks;
+    uint32_t max_pending_events;
+    // how much later than due timers ran in total and at most, only host_advance_time() makes them late
+    uint64_t timer_lateness_ms;
+    uint32_t max_timer_lateness_ms;
+} HostEventLoopStats;
+
+//! virtual time in milliseconds, timers, animations and time_ms() use it, it only advances with the functions below
+uint64_t host_time_ms(void);
+
+//! runs the entry that's due next, unless that's later than until_ms
+//! returns false if there was nothing to do
+bool host_run_next(uint64_t until_ms);
+
+//! runs all entries due until until_ms in order, then sets the virtual time to until_ms
+void host_run_until(uint64_t until_ms);
+
+//! advances the virtual time without running anything, models the time the watch's CPU is busy
+//! entries that became due meanwhile run late, in order, with the next host_run_next()
+void host_advance_time(uint64_t duration_ms);
+
+//! queues callback to run at time_ms, or now if that's in the past
+void host_post_callback(uint64_t time_ms, HostEventCallback callback, void *callback_data);
+
+HostEventLoopStats host_event_loop_get_stats(void);
+void host_event_loop_reset_stats(void);
+
+//! runs everything that's due before the next timer, then fires it, returns false if no timer is registered
+bool host_app_timer_fire_next(void);
+
+//! number of timers that are currently registered
+uint32_t host_app_timer_count(void);
+
+//! number of animations that are currently scheduled, they're destroyed once they stop like in SDK 3
+uint32_t host_animation_count(void);
+
+// ---------------
+// services
+
+//! deliver sensor data to the handlers subscribed via the *_service_subscribe() functions
+//! like on the watch, headings that differ less than the heading filter from the last delivered one are dropped
+void host_compass_service_emit(CompassHeadingData heading);
+void host_accel_data_service_emit(AccelData *data, uint32_t num_samples);
+void host_battery_state_service_emit(BatteryChargeState charge);
+
+//! like the *_emit() functions, but queued to be delivered at time_ms by the event loop
+void host_compass_service_post(uint64_t time_ms, CompassHeadingData heading);
+void host_accel_data_service_post(uint64_t time_ms, const AccelData *data, uint32_t num_samples);
+void host_battery_state_service_post(uint64_t time_ms, BatteryChargeState charge);
+
+//! state the app configured the services with
+AccelSamplingRate host_accel_service_get_sampling_rate(void);
+uint32_t host_accel_service_get_samples_per_update(void);
+CompassHeading host_compass_service_get_heading_filter(void);
+
+// ---------------
+// sensor traces
+
+//! reads a raw sensor trace or the "sensor trace" lines sensor_trace_log() wrote into a log, see src/sensor_trace.h
+//! returns NULL if the file can't be read, free() the result
+uint8_t *host_load_sensor_trace(const char *path, size_t *size);
+
+// ---------------
+// timing
+
+//! monotonic wall clock in nanoseconds, used to measure the cost of the app's code
+uint64_t host_clock_ns(void);
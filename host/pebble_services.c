@@ -0,0 +1,518 @@
+// stand-in for timers, animations, sensor services and the event loop of the Pebble SDK
+// everything runs in virtual time, nothing happens on its own, host tools run the event loop with the host_* functions from pebble_host.h
+
+#include <stdarg.h>
+#include <time.h>
+#include "pebble_host.h"
+
+// ---------------
+// logging
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "[%u] %s:%d ", log_level, src_filename, src_line_number);
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+}
+
+uint64_t host_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+// ---------------
+// event loop
+
+// timers, animation frames and callbacks posted by host tools share one queue, sorted by due time
+// entries with equal due time run in order of posting, so the order doesn't depend on their kind
+typedef enum {
+    HostEventKindAppTimer,
+    HostEventKindAnimationFrame,
+    HostEventKindCallback,
+} HostEventKind;
+
+typedef struct HostEvent {
+    uint64_t due_ms;
+    HostEventKind kind;
+    HostEventCallback callback;
+    void *callback_data;
+    struct HostEvent *next;
+} HostEvent;
+
+static HOST_THREAD_LOCAL HostEvent *s_events;
+static HOST_THREAD_LOCAL uint32_t s_event_counts[3];
+static HOST_THREAD_LOCAL uint64_t s_now_ms;
+static HOST_THREAD_LOCAL HostEventLoopStats s_event_loop_stats;
+
+static void insert_event(HostEvent *event) {
+    HostEvent **link = &s_events;
+    while (*link && (*link)->due_ms <= event->due_ms) {
+        link = &(*link)->next;
+    }
+    event->next = *link;
+    *link = event;
+
+    s_event_counts[event->kind]++;
+    const uint32_t pending = s_event_counts[0] + s_event_counts[1] + s_event_counts[2];
+    if (pending > s_event_loop_stats.max_pending_events) {
+        s_event_loop_stats.max_pending_events = pending;
+    }
+}
+
+static bool remove_event(HostEvent *event) {
+    for (HostEvent **link = &s_events; *link; link = &(*link)->next) {
+        if (*link == event) {
+            *link = event->next;
+            s_event_counts[event->kind]--;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t host_time_ms(void) {
+    return s_now_ms;
+}
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms) {
+    const uint16_t ms = (uint16_t) (s_now_ms % 1000);
+    if (tloc) *tloc = (time_t) (s_now_ms / 1000);
+    if (out_ms) *out_ms = ms;
+    return ms;
+}
+
+void host_post_callback(uint64_t time_ms, HostEventCallback callback, void *callback_data) {
+    HostEvent *event = calloc(1, sizeof(HostEvent));
+    event->due_ms = time_ms > s_now_ms ? time_ms : s_now_ms;
+    event->kind = HostEventKindCallback;
+    event->callback = callback;
+    event->callback_data = callback_data;
+    insert_event(event);
+}
+
+bool host_run_next(uint64_t until_ms) {
+    HostEvent *event = s_events;
+    if (!event || event->due_ms > until_ms) {
+        return false;
+    }
+    remove_event(event);
+    if (event->due_ms > s_now_ms) {
+        s_now_ms = event->due_ms;
+    } else if (event->kind == HostEventKindAppTimer) {
+        // host_advance_time() kept the loop busy past the due time
+        const uint32_t lateness_ms = (uint32_t) (s_now_ms - event->due_ms);
+        s_event_loop_stats.timer_lateness_ms += lateness_ms;
+        if (lateness_ms > s_event_loop_stats.max_timer_lateness_ms) {
+            s_event_loop_stats.max_timer_lateness_ms = lateness_ms;
+        }
+    }
+
+    HostEventCallback callback = event->callback;
+    void *callback_data = event->callback_data;
+    switch (event->kind) {
+        case HostEventKindAppTimer:
+            s_event_loop_stats.num_timers_fired++;
+            break;
+        case HostEventKindAnimationFrame:
+            s_event_loop_stats.num_animation_frames++;
+            break;
+        case HostEventKindCallback:
+            s_event_loop_stats.num_callbacks++;
+            break;
+    }
+    // like the firmware, a timer's handle is invalid once its callback runs
+    // animation frames are part of their animation and live as long as it does
+    if (event->kind != HostEventKindAnimationFrame) {
+        free(event);
+    }
+    callback(callback_data);
+    return true;
+}
+
+void host_advance_time(uint64_t duration_ms) {
+    s_now_ms += duration_ms;
+}
+
+void host_run_until(uint64_t until_ms) {
+    while (host_run_next(until_ms)) {
+    }
+    if (until_ms > s_now_ms) {
+        s_now_ms = until_ms;
+    }
+}
+
+HostEventLoopStats host_event_loop_get_stats(void) {
+    return s_event_loop_stats;
+}
+
+void host_event_loop_reset_stats(void) {
+    s_event_loop_stats = (HostEventLoopStats) {};
+}
+
+// ---------------
+// timers
+
+struct AppTimer {
+    HostEvent event;
+};
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data) {
+    AppTimer *result = calloc(1, sizeof(AppTimer));
+    result->event.due_ms = s_now_ms + timeout_ms;
+    result->event.kind = HostEventKindAppTimer;
+    result->event.callback = callback;
+    result->event.callback_data = callback_data;
+    insert_event(&result->event);
+    return result;
+}
+
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms) {
+    if (!remove_event(&timer_handle->event)) {
+        return false;
+    }
+    timer_handle->event.due_ms = s_now_ms + new_timeout_ms;
+    insert_event(&timer_handle->event);
+    return true;
+}
+
+void app_timer_cancel(AppTimer *timer_handle) {
+    if (remove_event(&timer_handle->event)) {
+        free(timer_handle);
+    }
+}
+
+bool host_app_timer_fire_next(void) {
+    if (s_event_counts[HostEventKindAppTimer] == 0) {
+        return false;
+    }
+    // everything that's due earlier runs first
+    const uint32_t fired = s_event_loop_stats.num_timers_fired;
+    while (s_event_loop_stats.num_timers_fired == fired && host_run_next(UINT64_MAX)) {
+    }
+    return true;
+}
+
+uint32_t host_app_timer_count(void) {
+    return s_event_counts[HostEventKindAppTimer];
+}
+
+// ---------------
+// animations
+
+// the firmware advances animations at about 30 frames per second
+#define HOST_ANIMATION_FRAME_MS 33
+
+struct Animation {
+    uint32_t duration_ms;
+    const AnimationImplementation *implementation;
+    AnimationHandlers handlers;
+    void *context;
+    bool scheduled;
+    bool started;
+    // step_animation() is running its handlers, which may destroy the animation, it frees it once they returned
+    bool stepping;
+    bool destroyed;
+    uint64_t start_ms;
+    // queued while the animation is scheduled
+    HostEvent frame;
+};
+
+static void step_animation(void *data);
+
+Animation *animation_create(void) {
+    Animation *result = calloc(1, sizeof(Animation));
+    result->duration_ms = 250;
+    result->frame.kind = HostEventKindAnimationFrame;
+    result->frame.callback = step_animation;
+    result->frame.callback_data = result;
+    return result;
+}
+
+static void free_animation(Animation *animation) {
+    if (animation->stepping) {
+        animation->destroyed = true;
+    } else {
+        free(animation);
+    }
+}
+
+bool animation_destroy(Animation *animation) {
+    if (!animation) return false;
+    remove_event(&animation->frame);
+    free_animation(animation);
+    return true;
+}
+
+bool animation_set_duration(Animation *animation, uint32_t duration_ms) {
+    animation->duration_ms = duration_ms;
+    return true;
+}
+
+bool animation_set_implementation(Animation *animation, const AnimationImplementation *implementation) {
+    animation->implementation = implementation;
+    return true;
+}
+
+bool animation_set_handlers(Animation *animation, AnimationHandlers callbacks, void *context) {
+    animation->handlers = callbacks;
+    animation->context = context;
+    return true;
+}
+
+void *animation_get_context(Animation *animation) {
+    return animation->context;
+}
+
+bool animation_schedule(Animation *animation) {
+    if (animation->scheduled) return true;
+
+    animation->scheduled = true;
+    animation->started = false;
+    animation->start_ms = s_now_ms;
+    animation->frame.due_ms = s_now_ms;
+    insert_event(&animation->frame);
+
+    if (animation->implementation && animation->implementation->setup) {
+        animation->implementation->setup(animation);
+    }
+    return true;
+}
+
+// like SDK 3, the animation is destroyed once the stopped handler returns
+static void finish_animation(Animation *animation, bool finished) {
+    remove_event(&animation->frame);
+    animation->scheduled = false;
+    if (animation->implementation && animation->implementation->teardown) {
+        animation->implementation->teardown(animation);
+    }
+    if (animation->handlers.stopped) {
+        animation->handlers.stopped(animation, finished, animation->context);
+    }
+    free_animation(animation);
+}
+
+bool animation_unschedule(Animation *animation) {
+    if (!animation || !animation->scheduled) return false;
+    finish_animation(animation, false);
+    return true;
+}
+
+bool animation_is_scheduled(Animation *animation) {
+    return animation->scheduled;
+}
+
+// returns false if the handlers that just ran destroyed the animation, it must not be touched anymore then
+static bool end_handlers(Animation *animation) {
+    animation->stepping = false;
+    if (!animation->destroyed) return true;
+    free(animation);
+    return false;
+}
+
+static void step_animation(void *data) {
+    Animation *animation = data;
+    if (!animation->started) {
+        animation->started = true;
+        if (animation->handlers.started) {
+            animation->stepping = true;
+            animation->handlers.started(animation, animation->context);
+            // the started handler may have unscheduled it
+            if (!end_handlers(animation)) return;
+        }
+    }
+
+    const uint64_t elapsed_ms = s_now_ms - animation->start_ms;
+    AnimationProgress progress = ANIMATION_NORMALIZED_MAX;
+    if (elapsed_ms < animation->duration_ms) {
+        progress = (AnimationProgress) (elapsed_ms * ANIMATION_NORMALIZED_MAX / animation->duration_ms);
+        animation->frame.due_ms = s_now_ms + HOST_ANIMATION_FRAME_MS;
+        insert_event(&animation->frame);
+    }
+    if (animation->implementation && animation->implementation->update) {
+        animation->stepping = true;
+        animation->implementation->update(animation, progress);
+        if (!end_handlers(animation)) return;
+    }
+    if (progress == ANIMATION_NORMALIZED_MAX && animation->scheduled) {
+        finish_animation(animation, true);
+    }
+}
+
+uint32_t host_animation_count(void) {
+    return s_event_counts[HostEventKindAnimationFrame];
+}
+
+// ---------------
+// accelerometer
+
+static HOST_THREAD_LOCAL AccelDataHandler s_accel_handler;
+static HOST_THREAD_LOCAL AccelSamplingRate s_accel_sampling_rate = ACCEL_SAMPLING_25HZ;
+static HOST_THREAD_LOCAL uint32_t s_accel_samples_per_update;
+
+int accel_service_set_sampling_rate(AccelSamplingRate rate) {
+    s_accel_sampling_rate = rate;
+    return 0;
+}
+
+int accel_service_set_samples_per_update(uint32_t num_samples) {
+    s_accel_samples_per_update = num_samples;
+    return 0;
+}
+
+void accel_data_service_subscribe(uint32_t samples_per_update, AccelDataHandler handler) {
+    s_accel_samples_per_update = samples_per_update;
+    s_accel_handler = handler;
+}
+
+void accel_data_service_unsubscribe(void) {
+    s_accel_handler = NULL;
+}
+
+void host_accel_data_service_emit(AccelData *data, uint32_t num_samples) {
+    if (s_accel_handler) {
+        s_accel_handler(data, num_samples);
+    }
+}
+
+typedef struct {
+    uint32_t num_samples;
+    AccelData samples[];
+} HostAccelBatch;
+
+static void deliver_accel_batch(void *data) {
+    HostAccelBatch *batch = data;
+    host_accel_data_service_emit(batch->samples, batch->num_samples);
+    free(batch);
+}
+
+void host_accel_data_service_post(uint64_t time_ms, const AccelData *data, uint32_t num_samples) {
+    HostAccelBatch *batch = malloc(sizeof(HostAccelBatch) + num_samples * sizeof(AccelData));
+    batch->num_samples = num_samples;
+    memcpy(batch->samples, data, num_samples * sizeof(AccelData));
+    host_post_callback(time_ms, deliver_accel_batch, batch);
+}
+
+AccelSamplingRate host_accel_service_get_sampling_rate(void) {
+    return s_accel_sampling_rate;
+}
+
+uint32_t host_accel_service_get_samples_per_update(void) {
+    return s_accel_samples_per_update;
+}
+
+// ---------------
+// compass
+
+static HOST_THREAD_LOCAL CompassHeadingHandler s_compass_handler;
+static HOST_THREAD_LOCAL CompassHeading s_compass_heading_filter;
+static HOST_THREAD_LOCAL CompassHeadingData s_compass_last_heading = {.compass_status = CompassStatusDataInvalid};
+// heading the handler saw last, the heading filter compares against this
+static HOST_THREAD_LOCAL CompassHeadingData s_compass_delivered_heading = {.compass_status = CompassStatusDataInvalid};
+
+int compass_service_set_heading_filter(CompassHeading filter) {
+    if (filter < 0 || filter > TRIG_MAX_ANGLE / 2) {
+        return -1;
+    }
+    s_compass_heading_filter = filter;
+    return 0;
+}
+
+void compass_service_subscribe(CompassHeadingHandler handler) {
+    s_compass_handler = handler;
+    // a new subscriber hasn't seen any heading yet
+    s_compass_delivered_heading = (CompassHeadingData) {.compass_status = CompassStatusDataInvalid};
+}
+
+void compass_service_unsubscribe(void) {
+    s_compass_handler = NULL;
+}
+
+int compass_service_peek(CompassHeadingData *data) {
+    *data = s_compass_last_heading;
+    return 0;
+}
+
+void host_compass_service_emit(CompassHeadingData heading) {
+    s_compass_last_heading = heading;
+
+    // like the firmware, hold back headings that changed less than the filter, unless the status changed
+    int32_t change = abs(heading.magnetic_heading - s_compass_delivered_heading.magnetic_heading) % TRIG_MAX_ANGLE;
+    change = change > TRIG_MAX_ANGLE / 2 ? TRIG_MAX_ANGLE - change : change;
+    if (heading.compass_status == s_compass_delivered_heading.compass_status && change < s_compass_heading_filter) {
+        return;
+    }
+
+    if (s_compass_handler) {
+        s_compass_delivered_heading = heading;
+        s_compass_handler(heading);
+    }
+}
+
+static void deliver_heading(void *data) {
+    CompassHeadingData *heading = data;
+    host_compass_service_emit(*heading);
+    free(heading);
+}
+
+void host_compass_service_post(uint64_t time_ms, CompassHeadingData heading) {
+    CompassHeadingData *data = malloc(sizeof(CompassHeadingData));
+    *data = heading;
+    host_post_callback(time_ms, deliver_heading, data);
+}
+
+CompassHeading host_compass_service_get_heading_filter(void) {
+    return s_compass_heading_filter;
+}
+
+// ---------------
+// battery
+
+static HOST_THREAD_LOCAL BatteryStateHandler s_battery_handler;
+static HOST_THREAD_LOCAL BatteryChargeState s_battery_state = {.charge_percent = 80};
+
+BatteryChargeState battery_state_service_peek(void) {
+    return s_battery_state;
+}
+
+void battery_state_service_subscribe(BatteryStateHandler handler) {
+    s_battery_handler = handler;
+}
+
+void battery_state_service_unsubscribe(void) {
+    s_battery_handler = NULL;
+}
+
+void host_battery_state_service_emit(BatteryChargeState charge) {
+    s_battery_state = charge;
+    if (s_battery_handler) {
+        s_battery_handler(charge);
+    }
+}
+
+static void deliver_battery_state(void *data) {
+    BatteryChargeState *charge = data;
+    host_battery_state_service_emit(*charge);
+    free(charge);
+}
+
+void host_battery_state_service_post(uint64_t time_ms, BatteryChargeState charge) {
+    BatteryChargeState *data = malloc(sizeof(BatteryChargeState));
+    *data = charge;
+    host_post_callback(time_ms, deliver_battery_state, data);
+}
+
+// ---------------
+// misc
+
+void vibes_long_pulse(void) {
+}
+
+void vibes_short_pulse(void) {
+}
+
+void app_event_loop(void) {
+    // host tools drive the event loop themselves, see host_run_next()
+}
@@ -0,0 +1,61 @@
+// loads sensor traces recorded with sensor_trace_log() for the host tools, see src/sensor_trace.h
+
+#include "pebble_host.h"
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// turns the "sensor trace 000030: 0a1b..." lines of a log back into the trace, returns the new size
+static size_t parse_log(uint8_t *data, size_t size) {
+    static const char marker[] = "sensor trace ";
+    size_t result = 0;
+    const char *text = (const char *) data;
+    const char *end = text + size;
+
+    while (text < end) {
+        const char *line_end = memchr(text, '\n', (size_t) (end - text));
+        if (!line_end) line_end = end;
+        const char *p = text;
+        while (p + sizeof(marker) - 1 <= line_end && memcmp(p, marker, sizeof(marker) - 1) != 0) p++;
+        if (p + sizeof(marker) - 1 <= line_end) {
+            p += sizeof(marker) - 1;
+            while (p < line_end && hex_value(*p) >= 0) p++;
+            if (p + 1 < line_end && p[0] == ':' && p[1] == ' ') {
+                // decoding in place is fine, the output never catches up with the input
+                for (p += 2; p + 1 < line_end && hex_value(p[0]) >= 0 && hex_value(p[1]) >= 0; p += 2) {
+                    data[result++] = (uint8_t) (hex_value(p[0]) << 4 | hex_value(p[1]));
+                }
+            }
+        }
+        text = line_end + 1;
+    }
+    return result;
+}
+
+uint8_t *host_load_sensor_trace(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+
+    size_t capacity = 64 * 1024;
+    uint8_t *result = malloc(capacity);
+    *size = 0;
+    size_t n;
+    while ((n = fread(result + *size, 1, capacity - *size, file)) > 0) {
+        *size += n;
+        if (*size == capacity) {
+            capacity *= 2;
+            result = realloc(result, capacity);
+        }
+    }
+    fclose(file);
+
+    // raw traces start with their header, anything else is treated as log
+    if (*size < 3 || memcmp(result, "CTR", 3) != 0) {
+        *size = parse_log(result, *size);
+    }
+    return result;
+}
@@ -0,0 +1,395 @@
+// stand-in for layers, text layers, bitmap layers, windows and the window stack of the Pebble SDK
+
+#include "pebble_host.h"
+
+// ---------------
+// layers
+
+struct Layer {
+    GRect frame;
+    GRect bounds;
+    bool hidden;
+    LayerUpdateProc update_proc;
+    Layer *parent;
+    Layer *first_child;
+    Layer *next_sibling;
+    Window *window;
+    void *data;
+};
+
+Layer *layer_create_with_data(GRect frame, size_t data_size) {
+    Layer *result = calloc(1, sizeof(Layer));
+    result->frame = frame;
+    result->bounds = (GRect){.size = frame.size};
+    if (data_size > 0) {
+        result->data = calloc(1, data_size);
+    }
+    return result;
+}
+
+Layer *layer_create(GRect frame) {
+    return layer_create_with_data(frame, 0);
+}
+
+void layer_destroy(Layer *layer) {
+    if (!layer) return;
+    layer_remove_from_parent(layer);
+    for (Layer *child = layer->first_child; child; child = child->next_sibling) {
+        child->parent = NULL;
+    }
+    free(layer->data);
+    free(layer);
+}
+
+void *layer_get_data(const Layer *layer) {
+    return layer->data;
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) {
+    layer->update_proc = update_proc;
+}
+
+// the host renders on demand, see host_window_render() and host_display_needs_render()
+static HOST_THREAD_LOCAL bool s_display_dirty;
+
+void layer_mark_dirty(Layer *layer) {
+    s_display_dirty = true;
+}
+
+bool host_display_needs_render(void) {
+    return s_display_dirty;
+}
+
+GRect layer_get_frame(const Layer *layer) {
+    return layer->frame;
+}
+
+// changing the frame, the bounds or the text marks the layer dirty, setting the same one again doesn't
+void layer_set_frame(Layer *layer, GRect frame) {
+    if (grect_equal(&layer->frame, &frame)) return;
+    layer_mark_dirty(layer);
+    // like the firmware, keep the bounds in sync as long as they cover the whole frame
+    if (layer->bounds.origin.x == 0 && layer->bounds.origin.y == 0 && gsize_equal(&layer->bounds.size, &layer->frame.size)) {
+        layer->bounds.size = frame.size;
+    }
+    layer->frame = frame;
+}
+
+GRect layer_get_bounds(const Layer *layer) {
+    return layer->bounds;
+}
+
+void layer_set_bounds(Layer *layer, GRect bounds) {
+    if (grect_equal(&layer->bounds, &bounds)) return;
+    layer_mark_dirty(layer);
+    layer->bounds = bounds;
+}
+
+void layer_add_child(Layer *parent, Layer *child) {
+    layer_remove_from_parent(child);
+    child->parent = parent;
+    Layer **link = &parent->first_child;
+    while (*link) {
+        link = &(*link)->next_sibling;
+    }
+    *link = child;
+}
+
+void layer_remove_from_parent(Layer *child) {
+    if (!child->parent) return;
+    Layer **link = &child->parent->first_child;
+    while (*link && *link != child) {
+        link = &(*link)->next_sibling;
+    }
+    if (*link) {
+        *link = child->next_sibling;
+    }
+    child->parent = NULL;
+    child->next_sibling = NULL;
+}
+
+Window *layer_get_window(const Layer *layer) {
+    while (layer->parent) {
+        layer = layer->parent;
+    }
+    return layer->window;
+}
+
+void layer_set_hidden(Layer *layer, bool hidden) {
+    layer->hidden = hidden;
+}
+
+bool layer_get_hidden(const Layer *layer) {
+    return layer->hidden;
+}
+
+static void render_layer(Layer *layer, GContext *ctx, GPoint offset) {
+    if (layer->hidden) return;
+
+    const GPoint origin = GPoint((int16_t) (offset.x + layer->frame.origin.x), (int16_t) (offset.y + layer->frame.origin.y));
+    if (layer->update_proc) {
+        host_graphics_context_set_drawing_box(ctx, (GRect){
+            .origin = GPoint((int16_t) (origin.x + layer->bounds.origin.x), (int16_t) (origin.y + layer->bounds.origin.y)),
+            .size = layer->frame.size,
+        });
+        layer->update_proc(layer, ctx);
+    }
+    for (Layer *child = layer->first_child; child; child = child->next_sibling) {
+        render_layer(child, ctx, origin);
+    }
+}
+
+void host_layer_render(Layer *layer, GContext *ctx) {
+    render_layer(layer, ctx, GPointZero);
+    host_graphics_context_set_drawing_box(ctx, (GRect){.size = host_display_size()});
+}
+
+// ---------------
+// text layers
+
+struct TextLayer {
+    Layer *layer;
+    const char *text;
+    GFont font;
+    GColor text_color;
+    GColor background_color;
+    GTextAlignment alignment;
+};
+
+static void text_layer_update_proc(Layer *layer, GContext *ctx) {
+    TextLayer *text_layer = *(TextLayer **) layer_get_data(layer);
+    const GRect bounds = layer_get_bounds(layer);
+    if (text_layer->background_color.a) {
+        graphics_context_set_fill_color(ctx, text_layer->background_color);
+        graphics_fill_rect(ctx, bounds, 0, GCornerNone);
+    }
+    if (text_layer->text && text_layer->text[0]) {
+        graphics_context_set_text_color(ctx, text_layer->text_color);
+        graphics_draw_text(ctx, text_layer->text, text_layer->font, bounds, GTextOverflowModeWordWrap, text_layer->alignment, NULL);
+    }
+}
+
+TextLayer *text_layer_create(GRect frame) {
+    TextLayer *result = calloc(1, sizeof(TextLayer));
+    result->layer = layer_create_with_data(frame, sizeof(TextLayer *));
+    *(TextLayer **) layer_get_data(result->layer) = result;
+    layer_set_update_proc(result->layer, text_layer_update_proc);
+    result->text = "";
+    result->font = fonts_get_system_font(FONT_KEY_GOTHIC_18);
+    result->text_color = GColorBlack;
+    result->background_color = GColorWhite;
+    return result;
+}
+
+void text_layer_destroy(TextLayer *text_layer) {
+    if (!text_layer) return;
+    layer_destroy(text_layer->layer);
+    free(text_layer);
+}
+
+Layer *text_layer_get_layer(TextLayer *text_layer) {
+    return text_layer->layer;
+}
+
+void text_layer_set_text(TextLayer *text_layer, const char *text) {
+    text_layer->text = text;
+    layer_mark_dirty(text_layer_get_layer(text_layer));
+}
+
+const char *text_layer_get_text(TextLayer *text_layer) {
+    return text_layer->text;
+}
+
+void text_layer_set_background_color(TextLayer *text_layer, GColor color) {
+    text_layer->background_color = color;
+}
+
+void text_layer_set_text_color(TextLayer *text_layer, GColor color) {
+    text_layer->text_color = color;
+}
+
+void text_layer_set_font(TextLayer *text_layer, GFont font) {
+    text_layer->font = font;
+}
+
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment) {
+    text_layer->alignment = text_alignment;
+}
+
+// ---------------
+// bitmap layers
+
+struct BitmapLayer {
+    Layer *layer;
+    const GBitmap *bitmap;
+    GCompOp compositing_mode;
+};
+
+static void bitmap_layer_update_proc(Layer *layer, GContext *ctx) {
+    BitmapLayer *bitmap_layer = *(BitmapLayer **) layer_get_data(layer);
+    if (bitmap_layer->bitmap) {
+        graphics_context_set_compositing_mode(ctx, bitmap_layer->compositing_mode);
+        graphics_draw_bitmap_in_rect(ctx, bitmap_layer->bitmap, layer_get_bounds(layer));
+        graphics_context_set_compositing_mode(ctx, GCompOpAssign);
+    }
+}
+
+BitmapLayer *bitmap_layer_create(GRect frame) {
+    BitmapLayer *result = calloc(1, sizeof(BitmapLayer));
+    result->layer = layer_create_with_data(frame, sizeof(BitmapLayer *));
+    *(BitmapLayer **) layer_get_data(result->layer) = result;
+    layer_set_update_proc(result->layer, bitmap_layer_update_proc);
+    return result;
+}
+
+void bitmap_layer_destroy(BitmapLayer *bitmap_layer) {
+    if (!bitmap_layer) return;
+    layer_destroy(bitmap_layer->layer);
+    free(bitmap_layer);
+}
+
+Layer *bitmap_layer_get_layer(const BitmapLayer *bitmap_layer) {
+    return bitmap_layer->layer;
+}
+
+void bitmap_layer_set_bitmap(BitmapLayer *bitmap_layer, const GBitmap *bitmap) {
+    bitmap_layer->bitmap = bitmap;
+}
+
+void bitmap_layer_set_compositing_mode(BitmapLayer *bitmap_layer, GCompOp mode) {
+    bitmap_layer->compositing_mode = mode;
+}
+
+// ---------------
+// windows
+
+struct Window {
+    Layer *root_layer;
+    WindowHandlers handlers;
+    void *user_data;
+    GColor background_color;
+    ClickConfigProvider click_config_provider;
+    ClickHandler click_handlers[NUM_BUTTONS];
+    bool loaded;
+};
+
+#define HOST_WINDOW_STACK_SIZE 8
+static HOST_THREAD_LOCAL Window *s_window_stack[HOST_WINDOW_STACK_SIZE];
+static HOST_THREAD_LOCAL uint32_t s_window_stack_count;
+
+// window_single_click_subscribe() has no window parameter, it configures the window being set up
+static HOST_THREAD_LOCAL Window *s_click_config_window;
+
+Window *window_create(void) {
+    Window *result = calloc(1, sizeof(Window));
+    result->root_layer = layer_create((GRect){.size = host_display_size()});
+    result->root_layer->window = result;
+    result->background_color = GColorWhite;
+    return result;
+}
+
+void window_destroy(Window *window) {
+    if (!window) return;
+    layer_destroy(window->root_layer);
+    free(window);
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers) {
+    window->handlers = handlers;
+}
+
+Layer *window_get_root_layer(const Window *window) {
+    return window->root_layer;
+}
+
+void window_set_background_color(Window *window, GColor background_color) {
+    window->background_color = background_color;
+}
+
+void window_set_user_data(Window *window, void *data) {
+    window->user_data = data;
+}
+
+void *window_get_user_data(const Window *window) {
+    return window->user_data;
+}
+
+void window_set_click_config_provider(Window *window, ClickConfigProvider click_config_provider) {
+    window->click_config_provider = click_config_provider;
+}
+
+void window_single_click_subscribe(ButtonId button_id, ClickHandler handler) {
+    if (s_click_config_window && button_id < NUM_BUTTONS) {
+        s_click_config_window->click_handlers[button_id] = handler;
+    }
+}
+
+void host_window_render(Window *window, GContext *ctx) {
+    s_display_dirty = false;
+    host_graphics_context_set_drawing_box(ctx, (GRect){.size = host_display_size()});
+    graphics_context_set_fill_color(ctx, window->background_color);
+    graphics_fill_rect(ctx, (GRect){.size = host_display_size()}, 0, GCornerNone);
+    host_layer_render(window->root_layer, ctx);
+}
+
+// ---------------
+// window stack
+
+static void window_appear(Window *window) {
+    if (!window->loaded) {
+        window->loaded = true;
+        if (window->click_config_provider) {
+            s_click_config_window = window;
+            window->click_config_provider(window);
+            s_click_config_window = NULL;
+        }
+        if (window->handlers.load) window->handlers.load(window);
+    }
+    if (window->handlers.appear) window->handlers.appear(window);
+    s_display_dirty = true;
+}
+
+static void window_disappear(Window *window, bool unload) {
+    if (window->handlers.disappear) window->handlers.disappear(window);
+    if (unload && window->loaded) {
+        window->loaded = false;
+        if (window->handlers.unload) window->handlers.unload(window);
+    }
+}
+
+void window_stack_push(Window *window, bool animated) {
+    if (s_window_stack_count == HOST_WINDOW_STACK_SIZE) return;
+    if (s_window_stack_count > 0) {
+        window_disappear(s_window_stack[s_window_stack_count - 1], false);
+    }
+    s_window_stack[s_window_stack_count++] = window;
+    window_appear(window);
+}
+
+Window *window_stack_pop(bool animated) {
+    if (s_window_stack_count == 0) return NULL;
+    Window *result = s_window_stack[--s_window_stack_count];
+    window_disappear(result, true);
+    if (s_window_stack_count > 0) {
+        window_appear(s_window_stack[s_window_stack_count - 1]);
+    }
+    return result;
+}
+
+void window_stack_pop_all(const bool animated) {
+    while (s_window_stack_count > 0) {
+        Window *window = s_window_stack[--s_window_stack_count];
+        window_disappear(window, true);
+    }
+}
+
+Window *window_stack_get_top_window(void) {
+    return s_window_stack_count > 0 ? s_window_stack[s_window_stack_count - 1] : NULL;
+}
+
+void host_window_stack_click(ButtonId button_id) {
+    Window *window = window_stack_get_top_window();
+    if (window && button_id < NUM_BUTTONS && window->click_handlers[button_id]) {
+        window->click_handlers[button_id](NULL, window);
+    }
+}
@@ -0,0 +1,235 @@
+// renders the compass into the frame buffer of the platform it was built for, 1-bit 144x168, 8-bit 144x168 or 8-bit round 180x180
+// a fixed set of scenes is compared with the golden images in host/golden, a spinning needle measures the throughput of the render path
+//
+// usage: render [-o dir] [-g dir] [-n frames]
+//
+// -o writes each scene as <dir>/<platform>-<scene>.ppm, -g compares each scene with the image of the same name in dir
+// instead of RENDER_GOLDEN_DIR, any pixel that differs fails the run, -n frames per mode of the throughput benchmark (500), 0 skips it
+
+#include <stdio.h>
+#include "pebble_host.h"
+#include "compass_window.h"
+
+#define RENDER_PLATFORM PBL_IF_ROUND_ELSE("chalk", PBL_IF_COLOR_ELSE("basalt", "aplite"))
+#define RENDER_DEFAULT_FRAMES 500
+// the checked in golden images, waf passes their absolute path
+#ifndef RENDER_GOLDEN_DIR
+#define RENDER_GOLDEN_DIR "host/golden"
+#endif
+// long enough for the needle, the orientation and the calibration window to settle
+#define RENDER_SETTLE_MS 4000
+#define RENDER_SENSOR_INTERVAL_MS 50
+// the update loop of the data provider runs at 22fps, see DATA_PROVIDER_FPS
+#define RENDER_FRAME_MS (1000 / 22)
+
+typedef struct {
+    const char *name;
+    int32_t heading_degrees;
+    AccelData accel;
+    bool needs_calibration;
+    // > 0 to switch to upright after settling flat and to render this far into the transition
+    uint32_t transition_ms;
+} RenderScene;
+
+static const AccelData RENDER_FLAT = {.x = 0, .y = 0, .z = -1000};
+static const AccelData RENDER_TILTED = {.x = 300, .y = -200, .z = -930};
+static const AccelData RENDER_UPRIGHT = {.x = 0, .y = -1000, .z = 0};
+
+static const RenderScene RENDER_SCENES[] = {
+    {"rose", 0, RENDER_FLAT, false, 0},
+    {"rose-tilted", 57, RENDER_TILTED, false, 0},
+    {"band", 123, RENDER_UPRIGHT, false, 0},
+    {"transition", 200, RENDER_FLAT, false, 500},
+    {"calibration", 30, RENDER_FLAT, true, 0},
+};
+
+static GContext *s_ctx;
+static CompassWindow *s_window;
+
+// ---------------
+// scenes
+
+static void post_sensors(uint64_t time_ms, int32_t heading_degrees, AccelData accel, bool needs_calibration) {
+    const int32_t degrees = (heading_degrees % 360 + 360) % 360;
+    const CompassHeading heading = (360 - degrees) % 360 * TRIG_MAX_ANGLE / 360;
+    host_compass_service_post(time_ms, (CompassHeadingData) {
+        .magnetic_heading = heading,
+        .true_heading = heading,
+        .compass_status = needs_calibration ? CompassStatusDataInvalid : CompassStatusCalibrated,
+        .is_declination_valid = true,
+    });
+    accel.timestamp = time_ms;
+    host_accel_data_service_post(time_ms, &accel, 1);
+}
+
+// keeps the watch still for duration_ms
+static void hold(int32_t heading_degrees, AccelData accel, bool needs_calibration, uint32_t duration_ms) {
+    const uint64_t start_ms = host_time_ms();
+    for (uint32_t t = 0; t < duration_ms; t += RENDER_SENSOR_INTERVAL_MS) {
+        post_sensors(start_ms + t, heading_degrees, accel, needs_calibration);
+    }
+    host_run_until(start_ms + duration_ms);
+}
+
+static void open_window(void) {
+    s_window = compass_window_create();
+    window_stack_push(compass_window_get_window(s_window), true);
+}
+
+static void close_window(void) {
+    window_stack_pop_all(false);
+    compass_window_destroy(s_window);
+    host_run_until(host_time_ms() + RENDER_SETTLE_MS);
+}
+
+static uint32_t checksum(const uint8_t *data, size_t size) {
+    uint32_t result = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        result = (result ^ data[i]) * 16777619u;
+    }
+    return result;
+}
+
+// number of pixels that differ from the golden image at path, -1 if it can't be read or has a different size
+static int32_t compare_with_golden(const char *path, const uint8_t *rgb, GSize size) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return -1;
+    int width, height, max_value;
+    int32_t result = -1;
+    if (fscanf(file, "P6 %d %d %d", &width, &height, &max_value) == 3 && fgetc(file) != EOF &&
+        width == size.w && height == size.h && max_value == 255) {
+        const size_t num_bytes = (size_t) width * height * 3;
+        uint8_t *golden = malloc(num_bytes);
+        if (fread(golden, 1, num_bytes, file) == num_bytes) {
+            result = 0;
+            for (size_t i = 0; i < num_bytes; i += 3) {
+                result += memcmp(golden + i, rgb + i, 3) != 0;
+            }
+        }
+        free(golden);
+    }
+    fclose(file);
+    return result;
+}
+
+static bool render_scene(const RenderScene *scene, const char *output_dir, const char *golden_dir) {
+    open_window();
+    if (scene->transition_ms) {
+        hold(scene->heading_degrees, scene->accel, scene->needs_calibration, RENDER_SETTLE_MS);
+        hold(scene->heading_degrees, RENDER_UPRIGHT, scene->needs_calibration, scene->transition_ms);
+    } else {
+        hold(scene->heading_degrees, scene->accel, scene->needs_calibration, RENDER_SETTLE_MS);
+    }
+
+    host_graphics_context_reset_stats(s_ctx);
+    host_window_render(window_stack_get_top_window(), s_ctx);
+    const HostGraphicsStats stats = host_graphics_context_get_stats(s_ctx);
+    close_window();
+
+    const GSize size = host_display_size();
+    const size_t num_bytes = (size_t) size.w * size.h * 3;
+    uint8_t *rgb = malloc(num_bytes);
+    host_graphics_context_get_rgb(s_ctx, rgb);
+
+    char path[1024];
+    bool result = true;
+    if (output_dir) {
+        snprintf(path, sizeof(path), "%s/%s-%s.ppm", output_dir, RENDER_PLATFORM, scene->name);
+        if (!host_graphics_context_write_ppm(s_ctx, path)) {
+            fprintf(stderr, "%s: can't write\n", path);
+            result = false;
+        }
+    }
+    char golden[32];
+    snprintf(path, sizeof(path), "%s/%s-%s.ppm", golden_dir, RENDER_PLATFORM, scene->name);
+    const int32_t num_different = compare_with_golden(path, rgb, size);
+    if (num_different < 0) {
+        snprintf(golden, sizeof(golden), "missing");
+    } else if (num_different > 0) {
+        snprintf(golden, sizeof(golden), "%d pixels differ", (int) num_different);
+    } else {
+        snprintf(golden, sizeof(golden), "ok");
+    }
+    result = result && num_different == 0;
+
+    printf("%-12s %8u %8u %8u %08x  %s\n", scene->name, (unsigned int) stats.draw_calls,
+           (unsigned int) stats.pixel_writes, (unsigned int) stats.frame_buffer_captures,
+           (unsigned int) checksum(rgb, num_bytes), golden);
+    free(rgb);
+    return result;
+}
+
+// ---------------
+// throughput
+
+// renders a frame per update of the needle while it follows a constantly turning heading
+static void benchmark(const char *name, AccelData accel, uint32_t num_frames) {
+    open_window();
+    hold(0, accel, false, RENDER_SETTLE_MS);
+
+    HostGraphicsStats total = {};
+    uint64_t render_ns = 0;
+    for (uint32_t frame = 0; frame < num_frames; frame++) {
+        post_sensors(host_time_ms(), (int32_t) (frame * 7), accel, false);
+        host_run_until(host_time_ms() + RENDER_FRAME_MS);
+
+        host_graphics_context_reset_stats(s_ctx);
+        const uint64_t start_ns = host_clock_ns();
+        host_window_render(window_stack_get_top_window(), s_ctx);
+        render_ns += host_clock_ns() - start_ns;
+        const HostGraphicsStats stats = host_graphics_context_get_stats(s_ctx);
+        total.draw_calls += stats.draw_calls;
+        total.pixel_writes += stats.pixel_writes;
+        total.frame_buffer_captures += stats.frame_buffer_captures;
+    }
+    close_window();
+
+    printf("%-12s %10.2f %10.0f %10.1f %10.0f %10.1f\n", name, render_ns / 1e3 / num_frames, num_frames * 1e9 / render_ns,
+           (double) total.draw_calls / num_frames, (double) total.pixel_writes / num_frames,
+           (double) total.frame_buffer_captures / num_frames);
+}
+
+// ---------------
+// main
+
+int main(int argc, char **argv) {
+    const char *output_dir = NULL;
+    const char *golden_dir = RENDER_GOLDEN_DIR;
+    int num_frames = RENDER_DEFAULT_FRAMES;
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "-o") == 0 && has_value) {
+            output_dir = argv[++i];
+        } else if (strcmp(argv[i], "-g") == 0 && has_value) {
+            golden_dir = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && has_value) {
+            num_frames = atoi(argv[++i]);
+        } else {
+            num_frames = -1;
+            break;
+        }
+    }
+    if (num_frames < 0) {
+        fprintf(stderr, "usage: %s [-o dir] [-g dir] [-n frames]\n", argv[0]);
+        return 2;
+    }
+
+    s_ctx = host_graphics_context_create();
+
+    const GSize size = host_display_size();
+    printf("%s, %dx%d\n", RENDER_PLATFORM, size.w, size.h);
+    printf("%-12s %8s %8s %8s %8s  %s\n", "scene", "draws", "pixels", "captures", "checksum", "golden");
+    bool success = true;
+    for (uint32_t i = 0; i < ARRAY_LENGTH(RENDER_SCENES); i++) {
+        success = render_scene(&RENDER_SCENES[i], output_dir, golden_dir) && success;
+    }
+
+    if (num_frames > 0) {
+        printf("%-12s %10s %10s %10s %10s %10s\n", "mode", "us/frame", "frames/s", "draws/f", "pixels/f", "captures/f");
+        benchmark("rose", RENDER_FLAT, (uint32_t) num_frames);
+        benchmark("band", RENDER_UPRIGHT, (uint32_t) num_frames);
+    }
+
+    host_graphics_context_destroy(s_ctx);
+    return success ? 0 : 1;
+}
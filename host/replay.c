@@ -0,0 +1,177 @@
+// replays a sensor trace recorded on the watch (see sensor_trace.h and RECORD_SENSOR_TRACE in compass.c)
+// the callbacks reach the compass window in virtual time, timers and animations run in between in the same order as on the watch
+// a run takes milliseconds instead of the length of the recording and gives the same result every time
+//
+// usage: replay [-v] trace
+//
+// trace is either the raw trace or a log that contains the "sensor trace" lines of sensor_trace_log()
+// -v prints a line per rendered frame
+
+#include <stdio.h>
+#include "pebble_host.h"
+#include "compass_window.h"
+#include "compass_calibration_window.h"
+#include "sensor_trace.h"
+
+// keep running after the last event until the needle and the transitions came to rest
+#define REPLAY_SETTLE_MS 3000
+
+typedef struct {
+    uint32_t num_events[3];
+    uint32_t num_frames;
+    uint32_t num_draw_calls;
+    uint32_t num_orientation_changes;
+    uint32_t num_calibration_shows;
+    // FNV-1a over the presentation angle and orientation of each frame, equal for equal behaviour
+    uint32_t checksum;
+    uint64_t busy_ns;
+} ReplayStats;
+
+static CompassWindow *s_window;
+static GContext *s_ctx;
+static ReplayStats s_stats = {.checksum = 2166136261u};
+static bool s_verbose;
+static DataProviderOrientation s_orientation;
+static bool s_calibration_shown;
+
+// ---------------
+// replaying
+
+static DataProvider *provider(void) {
+    return compass_window_get_data_provider(s_window);
+}
+
+static void checksum_add(uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        s_stats.checksum = (s_stats.checksum ^ ((value >> (i * 8)) & 0xff)) * 16777619u;
+    }
+}
+
+// like the firmware, render after the event handling if something changed
+static void render_if_needed(void) {
+    const DataProviderOrientation orientation = data_provider_get_orientation(provider());
+    if (orientation != s_orientation) {
+        s_orientation = orientation;
+        s_stats.num_orientation_changes++;
+    }
+    const bool calibration_shown = window_stack_get_top_window() != compass_window_get_window(s_window);
+    if (calibration_shown && !s_calibration_shown) {
+        s_stats.num_calibration_shows++;
+    }
+    s_calibration_shown = calibration_shown;
+
+    if (!host_display_needs_render()) return;
+
+    host_graphics_context_reset_stats(s_ctx);
+    host_window_render(window_stack_get_top_window(), s_ctx);
+    const uint32_t draw_calls = host_graphics_context_get_stats(s_ctx).draw_calls;
+    s_stats.num_frames++;
+    s_stats.num_draw_calls += draw_calls;
+
+    const int32_t angle = data_provider_get_presentation_angle(provider());
+    checksum_add((uint32_t) angle);
+    checksum_add((uint32_t) orientation << 1 | calibration_shown);
+    if (s_verbose) {
+        printf("%8u ms  frame %6u  angle %6d  orientation %d  calibration %d  draws %u\n",
+               (unsigned int) host_time_ms(), (unsigned int) s_stats.num_frames, (int) angle,
+               (int) orientation, calibration_shown, (unsigned int) draw_calls);
+    }
+}
+
+static void run_until(uint64_t time_ms) {
+    while (host_run_next(time_ms)) {
+        render_if_needed();
+    }
+    host_run_until(time_ms);
+}
+
+// queued behind everything that's due at the same time already, like on the watch
+static void post(uint64_t time_ms, SensorTraceEvent *event) {
+    switch (event->type) {
+        case SensorTraceEventCompass:
+            host_compass_service_post(time_ms, event->heading);
+            break;
+        case SensorTraceEventAccel:
+            host_accel_data_service_post(time_ms, event->accel.samples, event->accel.num_samples);
+            break;
+        case SensorTraceEventBattery:
+            host_battery_state_service_post(time_ms, event->battery);
+            break;
+    }
+    s_stats.num_events[event->type]++;
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            s_verbose = true;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s [-v] trace\n", argv[0]);
+        return 2;
+    }
+
+    size_t size;
+    uint8_t *data = host_load_sensor_trace(path, &size);
+    SensorTraceReader reader;
+    if (!data || !sensor_trace_reader_init(&reader, data, size)) {
+        fprintf(stderr, "%s: no sensor trace found\n", path);
+        free(data);
+        return 1;
+    }
+
+    s_ctx = host_graphics_context_create();
+    // frames and draw calls are enough, rasterizing would only slow the replay down
+    host_graphics_context_set_count_only(s_ctx, true);
+    s_window = compass_window_create();
+    window_stack_push(compass_window_get_window(s_window), true);
+    s_orientation = data_provider_get_orientation(provider());
+    render_if_needed();
+
+    // the trace starts at the first callback, the app has been running for a moment by then
+    const uint64_t start_ms = host_time_ms();
+    const uint64_t start_ns = host_clock_ns();
+    SensorTraceEvent event;
+    while (sensor_trace_reader_next(&reader, &event)) {
+        post(start_ms + event.time_ms, &event);
+        run_until(start_ms + event.time_ms);
+    }
+    const bool complete = reader.offset == reader.size;
+    run_until(host_time_ms() + REPLAY_SETTLE_MS);
+    s_stats.busy_ns = host_clock_ns() - start_ns;
+    const CompassWindowLayoutStats layout_stats = compass_window_get_layout_stats(s_window);
+    const DataProviderFrameStats frame_stats = data_provider_get_frame_stats(provider());
+    const DataProviderHeadingFilterStats heading_stats = data_provider_get_heading_filter_stats(provider());
+
+    printf("events           %u compass, %u accel, %u battery%s\n",
+           (unsigned int) s_stats.num_events[SensorTraceEventCompass],
+           (unsigned int) s_stats.num_events[SensorTraceEventAccel],
+           (unsigned int) s_stats.num_events[SensorTraceEventBattery],
+           complete ? "" : " (trace is truncated or corrupt)");
+    printf("virtual time     %.1f s\n", (host_time_ms() - start_ms) / 1000.0);
+    printf("wall time        %.1f ms\n", s_stats.busy_ns / 1e6);
+    printf("frames           %u, %u draw calls\n", (unsigned int) s_stats.num_frames, (unsigned int) s_stats.num_draw_calls);
+    printf("updates          %u delivered, %u coalesced, %u skipped\n", (unsigned int) frame_stats.num_frames,
+           (unsigned int) frame_stats.num_coalesced, (unsigned int) frame_stats.num_skipped);
+    printf("layout           %u updates, %u suppressed (%.1f%%)\n", (unsigned int) layout_stats.num_updates,
+           (unsigned int) layout_stats.num_suppressed,
+           layout_stats.num_updates ? 100.0 * layout_stats.num_suppressed / layout_stats.num_updates : 0);
+    printf("                 %u heading, %u level, %u transition\n", (unsigned int) layout_stats.num_heading_updates,
+           (unsigned int) layout_stats.num_level_updates, (unsigned int) layout_stats.num_transition_updates);
+    printf("compass          %u coarse, %u fine callbacks per minute\n",
+           (unsigned int) data_provider_heading_callbacks_per_minute(heading_stats, DataProviderHeadingFilterCoarse),
+           (unsigned int) data_provider_heading_callbacks_per_minute(heading_stats, DataProviderHeadingFilterFine));
+    printf("orientation      %u changes\n", (unsigned int) s_stats.num_orientation_changes);
+    printf("calibration      shown %u times\n", (unsigned int) s_stats.num_calibration_shows);
+    printf("checksum         %08x\n", (unsigned int) s_stats.checksum);
+
+    window_stack_pop_all(false);
+    compass_window_destroy(s_window);
+    host_graphics_context_destroy(s_ctx);
+    free(data);
+    return complete ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+// soak benchmark, runs long sessions of the compass window in virtual time
+// a scripted user turns, tilts and flips the watch, needs a calibration and plugs in the charger
+// each run is identical, the checksum proves it, the wall time shows the cost of the app's code over a whole session
+//
+// usage: soak [minutes] [runs]
+
+#include <stdio.h>
+#include "pebble_host.h"
+#include "compass_window.h"
+
+#define SOAK_DEFAULT_MINUTES 10
+#define SOAK_DEFAULT_RUNS 5
+
+// the firmware delivers headings at about 20Hz before the heading filter
+#define SOAK_COMPASS_INTERVAL_MS 50
+#define SOAK_MAX_ACCEL_SAMPLES 25
+
+typedef struct {
+    uint64_t end_ms;
+    uint32_t random;
+    // heading of the watch in degrees, before noise
+    int32_t heading_degrees;
+    uint32_t num_frames;
+    uint32_t num_draw_calls;
+    uint32_t checksum;
+} SoakSession;
+
+static CompassWindow *s_window;
+static GContext *s_ctx;
+static SoakSession s_session;
+
+// ---------------
+// scripted user
+
+// deterministic noise in -range...range
+static int32_t noise(int32_t range) {
+    s_session.random = s_session.random * 1103515245u + 12345u;
+    return (int32_t) ((s_session.random >> 16) % (uint32_t) (2 * range + 1)) - range;
+}
+
+// the script repeats every minute
+static uint32_t script_second(void) {
+    return (uint32_t) (host_time_ms() / 1000 % 60);
+}
+
+// 0-10s rest, 10-20s slow turn, 20-25s fast turns, 30-40s upright, 45-50s calibration needed, 50-55s charger plugged in
+static void post_heading(void *data) {
+    const uint32_t second = script_second();
+    if (second >= 10 && second < 20) {
+        s_session.heading_degrees += 1;
+    } else if (second >= 20 && second < 25) {
+        s_session.heading_degrees += (second % 2 ? 9 : -9);
+    }
+    const int32_t degrees = s_session.heading_degrees + noise(1);
+    host_compass_service_emit((CompassHeadingData) {
+        .magnetic_heading = ((360 - degrees % 360) % 360) * TRIG_MAX_ANGLE / 360,
+        .true_heading = ((360 - degrees % 360) % 360) * TRIG_MAX_ANGLE / 360,
+        .compass_status = second >= 45 && second < 50 ? CompassStatusDataInvalid : CompassStatusCalibrated,
+        .is_declination_valid = true,
+    });
+
+    if (host_time_ms() + SOAK_COMPASS_INTERVAL_MS < s_session.end_ms) {
+        host_post_callback(host_time_ms() + SOAK_COMPASS_INTERVAL_MS, post_heading, NULL);
+    }
+}
+
+// samples at the rate the app configured, the next batch is due once the app could have collected it
+static void post_accel_data(void *data) {
+    const uint32_t second = script_second();
+    const uint32_t rate = host_accel_service_get_sampling_rate();
+    uint32_t num_samples = host_accel_service_get_samples_per_update();
+    num_samples = num_samples < 1 ? 1 : num_samples > SOAK_MAX_ACCEL_SAMPLES ? SOAK_MAX_ACCEL_SAMPLES : num_samples;
+
+    AccelData samples[SOAK_MAX_ACCEL_SAMPLES];
+    const bool upright = second >= 30 && second < 40;
+    // turning the wrist shakes the watch
+    const int32_t shake = second >= 20 && second < 25 ? 150 : second >= 10 && second < 20 ? 20 : 3;
+    for (uint32_t i = 0; i < num_samples; i++) {
+        samples[i] = (AccelData) {
+            .x = (int16_t) noise(shake),
+            .y = (int16_t) ((upright ? -980 : -170) + noise(shake)),
+            .z = (int16_t) ((upright ? -170 : -980) + noise(shake)),
+            .timestamp = host_time_ms() + i * 1000 / rate,
+        };
+    }
+    host_accel_data_service_emit(samples, num_samples);
+
+    const uint64_t next_ms = host_time_ms() + num_samples * 1000 / rate;
+    if (next_ms < s_session.end_ms) {
+        host_post_callback(next_ms, post_accel_data, NULL);
+    }
+}
+
+static void post_battery_state(void *data) {
+    const uint32_t second = script_second();
+    host_battery_state_service_emit((BatteryChargeState) {
+        .charge_percent = 80,
+        .is_charging = second >= 50 && second < 55,
+        .is_plugged = second >= 50 && second < 55,
+    });
+
+    // the charger comes and goes at 50s and 55s into each minute
+    const uint64_t minute_ms = host_time_ms() / 60000 * 60000;
+    const uint64_t next_ms = second < 50 ? minute_ms + 50000 : second < 55 ? minute_ms + 55000 : minute_ms + 110000;
+    if (next_ms < s_session.end_ms) {
+        host_post_callback(next_ms, post_battery_state, NULL);
+    }
+}
+
+// ---------------
+// session
+
+static void checksum_add(uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        s_session.checksum = (s_session.checksum ^ ((value >> (i * 8)) & 0xff)) * 16777619u;
+    }
+}
+
+static void render_if_needed(void) {
+    if (!host_display_needs_render()) return;
+
+    host_graphics_context_reset_stats(s_ctx);
+    host_window_render(window_stack_get_top_window(), s_ctx);
+    s_session.num_frames++;
+    s_session.num_draw_calls += host_graphics_context_get_stats(s_ctx).draw_calls;
+    checksum_add((uint32_t) data_provider_get_presentation_angle(compass_window_get_data_provider(s_window)));
+}
+
+static void run_session(uint32_t run, uint32_t minutes) {
+    const uint64_t start_ms = host_time_ms();
+    s_session = (SoakSession) {
+        .end_ms = start_ms + minutes * 60000ull,
+        .random = 1,
+        .heading_degrees = 40,
+        .checksum = 2166136261u,
+    };
+    host_event_loop_reset_stats();
+
+    const uint64_t start_ns = host_clock_ns();
+    s_window = compass_window_create();
+    window_stack_push(compass_window_get_window(s_window), true);
+    DataProvider *provider = compass_window_get_data_provider(s_window);
+    host_post_callback(start_ms, post_heading, NULL);
+    host_post_callback(start_ms, post_accel_data, NULL);
+    host_post_callback(start_ms, post_battery_state, NULL);
+
+    while (host_run_next(s_session.end_ms)) {
+        render_if_needed();
+    }
+    host_run_until(s_session.end_ms);
+
+    const DataProviderHeadingFilterStats heading_stats = data_provider_get_heading_filter_stats(provider);
+    const HostEventLoopStats loop_stats = host_event_loop_get_stats();
+    window_stack_pop_all(false);
+    compass_window_destroy(s_window);
+    const uint64_t wall_ns = host_clock_ns() - start_ns;
+
+    printf("%3u %10.1f %9.0fx %8u %8u %8u %8u %8u %8u %8u %6u %08x\n",
+           (unsigned int) run, wall_ns / 1e6, minutes * 60e9 / wall_ns,
+           (unsigned int) (s_session.num_frames / minutes),
+           (unsigned int) (s_session.num_draw_calls / s_session.num_frames),
+           (unsigned int) (loop_stats.num_timers_fired / minutes),
+           (unsigned int) (loop_stats.num_animation_frames / minutes),
+           (unsigned int) (loop_stats.num_callbacks / minutes),
+           (unsigned int) data_provider_heading_callbacks_per_minute(heading_stats, DataProviderHeadingFilterCoarse),
+           (unsigned int) data_provider_heading_callbacks_per_minute(heading_stats, DataProviderHeadingFilterFine),
+           (unsigned int) loop_stats.max_pending_events,
+           (unsigned int) s_session.checksum);
+}
+
+int main(int argc, char **argv) {
+    const uint32_t minutes = argc > 1 ? (uint32_t) atoi(argv[1]) : SOAK_DEFAULT_MINUTES;
+    const uint32_t runs = argc > 2 ? (uint32_t) atoi(argv[2]) : SOAK_DEFAULT_RUNS;
+    if (minutes < 1 || runs < 1) {
+        fprintf(stderr, "usage: %s [minutes] [runs]\n", argv[0]);
+        return 2;
+    }
+
+    s_ctx = host_graphics_context_create();
+    // only the app's code counts, the stand-in's rasterizer would dominate the wall time
+    host_graphics_context_set_count_only(s_ctx, true);
+
+    printf("%u minute sessions, per minute of virtual time\n", (unsigned int) minutes);
+    printf("%3s %10s %10s %8s %8s %8s %8s %8s %8s %8s %6s %8s\n",
+           "run", "wall ms", "speedup", "frames", "draws/f", "timers", "anim", "sensor", "coarse", "fine", "queue", "checksum");
+    for (uint32_t run = 1; run <= runs; run++) {
+        run_session(run, minutes);
+    }
+
+    // a session must leave nothing behind
+    const uint32_t leaked_timers = host_app_timer_count();
+    const uint32_t leaked_animations = host_animation_count();
+    if (leaked_timers || leaked_animations) {
+        printf("leaked %u timers and %u animations\n", (unsigned int) leaked_timers, (unsigned int) leaked_animations);
+    }
+
+    host_graphics_context_destroy(s_ctx);
+    return leaked_timers || leaked_animations ? 1 : 0;
+}
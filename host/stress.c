@@ -0,0 +1,290 @@
+// stress benchmark, drives the compass window with synthetic worst-case sensor input
+// compass and accelerometer callbacks arrive at a configurable rate, well above what the firmware delivers
+// the time each handler takes on the host, scaled by a CPU factor, keeps the virtual clock busy
+// so the update loop runs late once the watch couldn't keep up, each frame period it loses counts as a dropped frame
+//
+// usage: stress [-r hz] [-n samples] [-d seconds] [-c cpu-factor] [scenario...]
+//
+// scenarios, combine any of them, all of them without one:
+//   spin          constant rotation, 90 degrees per second
+//   steps         90 degree turns every 2 seconds
+//   shake         noisy wrist shake, disturbs the accelerometer and the heading
+//   flips         orientation flips between flat and upright every second
+//   interference  charger plugged in and out every 3 seconds
+//   calibration   the compass needs a calibration for 1 of every 5 seconds
+//
+// -r callbacks per second of each sensor (100), -n accelerometer samples per callback (1)
+// -d virtual duration (60), -c how much slower the watch runs the same code than this host (100)
+
+#include <stdio.h>
+#include "pebble_host.h"
+#include "compass_window.h"
+
+// the update loop of the data provider runs at 22fps, see DATA_PROVIDER_FPS
+#define STRESS_FRAME_MS (1000 / 22)
+#define STRESS_MAX_ACCEL_SAMPLES 25
+
+typedef enum {
+    StressScenarioSpin = 1 << 0,
+    StressScenarioSteps = 1 << 1,
+    StressScenarioShake = 1 << 2,
+    StressScenarioFlips = 1 << 3,
+    StressScenarioInterference = 1 << 4,
+    StressScenarioCalibration = 1 << 5,
+} StressScenario;
+
+static const char *const STRESS_SCENARIO_NAMES[] = {"spin", "steps", "shake", "flips", "interference", "calibration"};
+
+typedef struct {
+    uint32_t scenarios;
+    uint32_t rate_hz;
+    uint32_t samples_per_callback;
+    uint32_t duration_s;
+    double cpu_factor;
+} StressConfig;
+
+// what the event loop ran, the stats of each kind are kept apart
+typedef enum {
+    StressWorkCompass,
+    StressWorkAccel,
+    StressWorkBattery,
+    StressWorkUpdateLoop,
+    StressWorkAnimation,
+    StressWorkRender,
+    StressWorkCount,
+} StressWork;
+
+static const char *const STRESS_WORK_NAMES[] = {"compass", "accel", "battery", "update loop", "animation", "render"};
+
+typedef struct {
+    uint32_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+} StressWorkStats;
+
+static StressConfig s_config = {.rate_hz = 100, .samples_per_callback = 1, .duration_s = 60, .cpu_factor = 100};
+static StressWorkStats s_work[StressWorkCount];
+static StressWork s_generator_work;
+static uint64_t s_end_ms;
+static uint32_t s_random = 1;
+static CompassWindow *s_window;
+static GContext *s_ctx;
+// host nanoseconds times the CPU factor not yet turned into virtual milliseconds
+static double s_busy_ns;
+
+// ---------------
+// generator
+
+static bool has(StressScenario scenario) {
+    return (s_config.scenarios & scenario) != 0;
+}
+
+static int32_t noise(int32_t range) {
+    s_random = s_random * 1103515245u + 12345u;
+    return (int32_t) ((s_random >> 16) % (uint32_t) (2 * range + 1)) - range;
+}
+
+static uint64_t interval_ms(void) {
+    const uint64_t result = 1000 / s_config.rate_hz;
+    return result > 0 ? result : 1;
+}
+
+static void post_next(HostEventCallback callback, uint64_t due_ms) {
+    if (due_ms < s_end_ms) {
+        host_post_callback(due_ms, callback, NULL);
+    }
+}
+
+static void generate_heading(void *data) {
+    s_generator_work = StressWorkCompass;
+    const uint64_t now = host_time_ms();
+    int32_t degrees = 0;
+    if (has(StressScenarioSpin)) {
+        degrees += (int32_t) (now * 90 / 1000);
+    }
+    if (has(StressScenarioSteps)) {
+        degrees += (int32_t) (now / 2000 % 4) * 90;
+    }
+    if (has(StressScenarioShake)) {
+        degrees += noise(15);
+    }
+    const bool invalid = has(StressScenarioCalibration) && now / 1000 % 5 == 4;
+    const int32_t angle = (360 - (degrees % 360 + 360) % 360) % 360 * TRIG_MAX_ANGLE / 360;
+    host_compass_service_emit((CompassHeadingData) {
+        .magnetic_heading = angle,
+        .true_heading = angle,
+        .compass_status = invalid ? CompassStatusDataInvalid : CompassStatusCalibrated,
+        .is_declination_valid = true,
+    });
+    post_next(generate_heading, now + interval_ms());
+}
+
+static void generate_accel_data(void *data) {
+    s_generator_work = StressWorkAccel;
+    const uint64_t now = host_time_ms();
+    const bool upright = has(StressScenarioFlips) && now / 1000 % 2 == 1;
+    const int32_t shake = has(StressScenarioShake) ? 400 : 5;
+
+    AccelData samples[STRESS_MAX_ACCEL_SAMPLES];
+    for (uint32_t i = 0; i < s_config.samples_per_callback; i++) {
+        samples[i] = (AccelData) {
+            .x = (int16_t) noise(shake),
+            .y = (int16_t) ((upright ? -1000 : 0) + noise(shake)),
+            .z = (int16_t) ((upright ? 0 : -1000) + noise(shake)),
+            .timestamp = now,
+        };
+    }
+    host_accel_data_service_emit(samples, s_config.samples_per_callback);
+    post_next(generate_accel_data, now + interval_ms());
+}
+
+static void generate_battery_state(void *data) {
+    s_generator_work = StressWorkBattery;
+    const uint64_t now = host_time_ms();
+    const bool plugged = now / 3000 % 2 == 1;
+    host_battery_state_service_emit((BatteryChargeState) {.charge_percent = 80, .is_charging = plugged, .is_plugged = plugged});
+    post_next(generate_battery_state, (now / 3000 + 1) * 3000);
+}
+
+// ---------------
+// measuring
+
+static void account(StressWork work, uint64_t ns) {
+    StressWorkStats *stats = &s_work[work];
+    stats->count++;
+    stats->total_ns += ns;
+    stats->max_ns = ns > stats->max_ns ? ns : stats->max_ns;
+
+    // the watch is busy meanwhile, whatever becomes due runs late
+    s_busy_ns += ns * s_config.cpu_factor;
+    if (s_busy_ns >= 1e6) {
+        const uint64_t busy_ms = (uint64_t) (s_busy_ns / 1e6);
+        s_busy_ns -= busy_ms * 1e6;
+        host_advance_time(busy_ms);
+    }
+}
+
+static void run(void) {
+    for (;;) {
+        const HostEventLoopStats before = host_event_loop_get_stats();
+        uint64_t start_ns = host_clock_ns();
+        if (!host_run_next(s_end_ms)) break;
+        const uint64_t ns = host_clock_ns() - start_ns;
+        const HostEventLoopStats after = host_event_loop_get_stats();
+
+        if (after.num_timers_fired != before.num_timers_fired) {
+            account(StressWorkUpdateLoop, ns);
+        } else if (after.num_animation_frames != before.num_animation_frames) {
+            account(StressWorkAnimation, ns);
+        } else {
+            account(s_generator_work, ns);
+        }
+
+        if (host_display_needs_render()) {
+            start_ns = host_clock_ns();
+            host_window_render(window_stack_get_top_window(), s_ctx);
+            account(StressWorkRender, host_clock_ns() - start_ns);
+        }
+    }
+    host_run_until(s_end_ms);
+}
+
+// ---------------
+// main
+
+static bool parse_scenario(const char *name) {
+    if (strcmp(name, "all") == 0) {
+        s_config.scenarios = (1 << ARRAY_LENGTH(STRESS_SCENARIO_NAMES)) - 1;
+        return true;
+    }
+    for (uint32_t i = 0; i < ARRAY_LENGTH(STRESS_SCENARIO_NAMES); i++) {
+        if (strcmp(name, STRESS_SCENARIO_NAMES[i]) == 0) {
+            s_config.scenarios |= 1 << i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_arguments(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "-r") == 0 && has_value) {
+            s_config.rate_hz = (uint32_t) atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && has_value) {
+            s_config.samples_per_callback = (uint32_t) atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-d") == 0 && has_value) {
+            s_config.duration_s = (uint32_t) atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && has_value) {
+            s_config.cpu_factor = atof(argv[++i]);
+        } else if (!parse_scenario(argv[i])) {
+            return false;
+        }
+    }
+    if (!s_config.scenarios) {
+        parse_scenario("all");
+    }
+    return s_config.rate_hz >= 1 && s_config.duration_s >= 1 && s_config.cpu_factor >= 0 &&
+           s_config.samples_per_callback >= 1 && s_config.samples_per_callback <= STRESS_MAX_ACCEL_SAMPLES;
+}
+
+int main(int argc, char **argv) {
+    if (!parse_arguments(argc, argv)) {
+        fprintf(stderr, "usage: %s [-r hz] [-n samples] [-d seconds] [-c cpu-factor] [spin|steps|shake|flips|interference|calibration|all...]\n", argv[0]);
+        return 2;
+    }
+
+    printf("scenarios");
+    for (uint32_t i = 0; i < ARRAY_LENGTH(STRESS_SCENARIO_NAMES); i++) {
+        if (s_config.scenarios & (1 << i)) printf(" %s", STRESS_SCENARIO_NAMES[i]);
+    }
+    printf(", %u Hz, %u samples per callback, %u s, cpu factor %.0f\n",
+           (unsigned int) s_config.rate_hz, (unsigned int) s_config.samples_per_callback,
+           (unsigned int) s_config.duration_s, s_config.cpu_factor);
+
+    s_ctx = host_graphics_context_create();
+    // the handlers' time is what the watch would spend, the stand-in's rasterizer isn't part of it
+    host_graphics_context_set_count_only(s_ctx, true);
+    s_window = compass_window_create();
+    window_stack_push(compass_window_get_window(s_window), true);
+
+    const uint64_t start_ms = host_time_ms();
+    s_end_ms = start_ms + s_config.duration_s * 1000ull;
+    host_post_callback(start_ms, generate_heading, NULL);
+    host_post_callback(start_ms, generate_accel_data, NULL);
+    if (has(StressScenarioInterference)) {
+        host_post_callback(start_ms, generate_battery_state, NULL);
+    }
+    host_event_loop_reset_stats();
+    run();
+    const HostEventLoopStats loop_stats = host_event_loop_get_stats();
+
+    uint64_t total_ns = 0;
+    for (uint32_t i = 0; i < StressWorkCount; i++) {
+        total_ns += s_work[i].total_ns;
+    }
+    printf("%-12s %8s %10s %10s %8s\n", "work", "count", "avg us", "max us", "share");
+    for (uint32_t i = 0; i < StressWorkCount; i++) {
+        const StressWorkStats *stats = &s_work[i];
+        if (!stats->count) continue;
+        printf("%-12s %8u %10.2f %10.2f %7.1f%%\n", STRESS_WORK_NAMES[i], (unsigned int) stats->count,
+               stats->total_ns / 1e3 / stats->count, stats->max_ns / 1e3, 100.0 * stats->total_ns / total_ns);
+    }
+
+    const uint32_t num_sensor_callbacks = s_work[StressWorkCompass].count + s_work[StressWorkAccel].count;
+    const uint64_t sensor_ns = s_work[StressWorkCompass].total_ns + s_work[StressWorkAccel].total_ns;
+    const uint32_t num_frames = s_work[StressWorkUpdateLoop].count;
+    const uint32_t num_dropped = (uint32_t) (loop_stats.timer_lateness_ms / STRESS_FRAME_MS);
+    printf("throughput   %.0f sensor callbacks per second on this host, handlers included\n",
+           sensor_ns ? num_sensor_callbacks * 1e9 / sensor_ns : 0);
+    printf("watch load   %.1f%% of the CPU\n", 100.0 * total_ns * s_config.cpu_factor / (s_config.duration_s * 1e9));
+    printf("frames       %u updates, %u dropped (%.1f%%), up to %u ms late\n",
+           (unsigned int) num_frames, (unsigned int) num_dropped,
+           num_frames + num_dropped ? 100.0 * num_dropped / (num_frames + num_dropped) : 0,
+           (unsigned int) loop_stats.max_timer_lateness_ms);
+
+    window_stack_pop_all(false);
+    compass_window_destroy(s_window);
+    host_graphics_context_destroy(s_ctx);
+    return 0;
+}
@@ -0,0 +1,334 @@
+// parameter sweep for the spring physics of the data provider
+// replays a heading trace through one provider per friction/attraction pair, spread over all cores
+// prints per pair how long the needle takes to settle after a turn, how far it overshoots, how much it jitters at rest
+// and how often it wakes up, compare these to pick the trade-off between latency and battery
+//
+// usage: sweep [-j threads] [-f from:to:step] [-a from:to:step] [trace]
+//
+// trace is a sensor trace or a log that contains one, like for replay.c, without one a synthetic 5 minute session is used
+// overshoot and jitter are in degrees, jitter is the RMS of the needle's motion per update between turns
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "pebble_host.h"
+#include "data_provider.h"
+#include "sensor_trace.h"
+
+// a turn starts once the needle is this far from its target and ends once it stayed within the settle band for a while
+#define SWEEP_STEP_DEGREES 10.0
+#define SWEEP_SETTLE_DEGREES 1.0
+#define SWEEP_SETTLE_HOLD_MS 300
+
+// the values data_provider_create() uses
+#define SWEEP_DEFAULT_FRICTION 0.9
+#define SWEEP_DEFAULT_ATTRACTION 0.05
+
+#define SWEEP_SYNTHETIC_MINUTES 5
+
+typedef struct {
+    double from, to, step;
+} SweepRange;
+
+typedef struct {
+    DataProviderFixed friction;
+    DataProviderFixed attraction;
+
+    // state of the current turn
+    bool turning;
+    double direction;
+    uint64_t turn_start_ms;
+    uint64_t in_band_since_ms;
+    double overshoot;
+    double last_angle;
+    bool has_last_angle;
+
+    // results
+    uint32_t num_turns;
+    uint32_t num_unsettled_turns;
+    double settle_ms_sum;
+    double settle_ms_max;
+    double overshoot_sum;
+    double jitter_square_sum;
+    uint32_t num_jitter_samples;
+    uint32_t num_updates;
+    uint32_t num_compass_callbacks;
+    uint64_t duration_ms;
+} SweepJob;
+
+static const uint8_t *s_trace;
+static size_t s_trace_size;
+static SweepJob *s_jobs;
+static uint32_t s_num_jobs;
+static atomic_uint s_next_job;
+
+// ---------------
+// synthetic session
+
+static uint32_t s_random = 1;
+
+static int32_t noise(int32_t range) {
+    s_random = s_random * 1103515245u + 12345u;
+    return (int32_t) ((s_random >> 16) % (uint32_t) (2 * range + 1)) - range;
+}
+
+// a turn every 8 seconds, large ones and small ones, each done within 300ms like a user would
+static SensorTrace *create_synthetic_trace(void) {
+    static const int32_t turns[] = {90, -30, 150, -8, -45, 5, 120, -170};
+    SensorTrace *result = sensor_trace_create(4 * 1024 * 1024);
+
+    int32_t heading = 0;
+    int32_t turn = 0;
+    for (uint64_t ms = 0; ms < SWEEP_SYNTHETIC_MINUTES * 60000; ms += 50) {
+        const uint64_t phase = ms % 8000;
+        if (phase == 0) {
+            turn = turns[(ms / 8000) % ARRAY_LENGTH(turns)];
+        }
+        const int32_t degrees = heading + (phase < 300 ? turn * (int32_t) phase / 300 : turn);
+        if (phase == 7950) {
+            heading += turn;
+        }
+        const int32_t noisy = ((degrees + noise(1)) % 360 + 360) % 360;
+        sensor_trace_record_compass(result, ms, (CompassHeadingData) {
+            .magnetic_heading = (360 - noisy) % 360 * TRIG_MAX_ANGLE / 360,
+            .compass_status = CompassStatusCalibrated,
+        });
+
+        // the watch lies flat, 5 samples at 25Hz
+        if (ms % 200 == 0) {
+            AccelData samples[5];
+            for (uint32_t i = 0; i < ARRAY_LENGTH(samples); i++) {
+                samples[i] = (AccelData) {.x = (int16_t) noise(5), .y = (int16_t) noise(5), .z = (int16_t) (-1000 + noise(5)), .timestamp = ms + i * 40};
+            }
+            sensor_trace_record_accel(result, ms, samples, ARRAY_LENGTH(samples));
+        }
+    }
+    return result;
+}
+
+// ---------------
+// measuring
+
+static double degrees(int32_t angle) {
+    return angle * 360.0 / TRIG_MAX_ANGLE;
+}
+
+static double wrap_degrees(double d) {
+    while (d < -180) d += 360;
+    while (d > 180) d -= 360;
+    return d;
+}
+
+static DataProviderFixed friction_modifier(DataProvider *provider, DataProviderFixed factor, void *user_data) {
+    SweepJob *job = user_data;
+    return job->friction;
+}
+
+static DataProviderFixed attraction_modifier(DataProvider *provider, DataProviderFixed factor, void *user_data) {
+    SweepJob *job = user_data;
+    return job->attraction;
+}
+
+static void end_turn(SweepJob *job, uint64_t settled_ms) {
+    const double settle_ms = (double) (settled_ms - job->turn_start_ms);
+    job->turning = false;
+    job->num_turns++;
+    job->settle_ms_sum += settle_ms;
+    job->settle_ms_max = settle_ms > job->settle_ms_max ? settle_ms : job->settle_ms_max;
+    job->overshoot_sum += job->overshoot;
+}
+
+// called once per iteration of the update loop
+static void handle_update(DataProvider *provider, void *user_data) {
+    SweepJob *job = user_data;
+    const uint64_t now = host_time_ms();
+    const double angle = degrees(data_provider_get_presentation_angle(provider));
+    const double error = wrap_degrees(degrees(data_provider_get_target_angle(provider)) - angle);
+    job->num_updates++;
+
+    if (!job->turning && fabs(error) > SWEEP_STEP_DEGREES) {
+        job->turning = true;
+        job->direction = error > 0 ? 1 : -1;
+        job->turn_start_ms = now;
+        job->in_band_since_ms = 0;
+        job->overshoot = 0;
+    }
+
+    if (job->turning) {
+        // past the target in the direction of the turn
+        const double overshoot = -error * job->direction;
+        job->overshoot = overshoot > job->overshoot ? overshoot : job->overshoot;
+
+        if (fabs(error) >= SWEEP_SETTLE_DEGREES) {
+            job->in_band_since_ms = 0;
+        } else if (job->in_band_since_ms == 0) {
+            job->in_band_since_ms = now;
+        } else if (now - job->in_band_since_ms >= SWEEP_SETTLE_HOLD_MS) {
+            end_turn(job, job->in_band_since_ms);
+        }
+    } else if (job->has_last_angle) {
+        // the needle should rest between turns, any motion here is noise getting through
+        const double delta = wrap_degrees(angle - job->last_angle);
+        job->jitter_square_sum += delta * delta;
+        job->num_jitter_samples++;
+    }
+    job->last_angle = angle;
+    job->has_last_angle = true;
+}
+
+// the update loop parked, so the needle reached its target and won't move until the next change
+static void handle_animating_changed(DataProvider *provider, void *user_data) {
+    SweepJob *job = user_data;
+    if (job->turning && !data_provider_is_animating(provider)) {
+        end_turn(job, job->in_band_since_ms ? job->in_band_since_ms : host_time_ms());
+    }
+}
+
+static void run_job(SweepJob *job) {
+    DataProvider *provider = data_provider_create(job, (DataProviderHandlers) {
+        .presented_angle_or_accel_data_changed = handle_update,
+        .animating_changed = handle_animating_changed,
+        .friction_modifier_fixed = friction_modifier,
+        .attraction_modifier_fixed = attraction_modifier,
+    });
+
+    SensorTraceReader reader;
+    sensor_trace_reader_init(&reader, s_trace, s_trace_size);
+    const uint64_t start_ms = host_time_ms();
+    SensorTraceEvent event;
+    while (sensor_trace_reader_next(&reader, &event)) {
+        const uint64_t time_ms = start_ms + event.time_ms;
+        switch (event.type) {
+            case SensorTraceEventCompass:
+                host_compass_service_post(time_ms, event.heading);
+                break;
+            case SensorTraceEventAccel:
+                host_accel_data_service_post(time_ms, event.accel.samples, event.accel.num_samples);
+                break;
+            case SensorTraceEventBattery:
+                host_battery_state_service_post(time_ms, event.battery);
+                break;
+        }
+        host_run_until(time_ms);
+    }
+    host_run_until(host_time_ms() + 5000);
+    if (job->turning) {
+        job->turning = false;
+        job->num_unsettled_turns++;
+    }
+
+    const DataProviderHeadingFilterStats heading_stats = data_provider_get_heading_filter_stats(provider);
+    job->num_compass_callbacks = heading_stats.num_callbacks[0] + heading_stats.num_callbacks[1];
+    job->duration_ms = host_time_ms() - start_ms;
+    data_provider_destroy(provider);
+}
+
+// each thread has its own virtual time and services, see HOST_THREAD_LOCAL
+static void *run_jobs(void *data) {
+    for (uint32_t i = atomic_fetch_add(&s_next_job, 1); i < s_num_jobs; i = atomic_fetch_add(&s_next_job, 1)) {
+        run_job(&s_jobs[i]);
+    }
+    return NULL;
+}
+
+// ---------------
+// main
+
+static bool parse_range(const char *text, SweepRange *range) {
+    return sscanf(text, "%lf:%lf:%lf", &range->from, &range->to, &range->step) == 3 && range->step > 0 && range->from <= range->to;
+}
+
+static uint32_t range_count(const SweepRange *range) {
+    return (uint32_t) ((range->to - range->from) / range->step + 1.5);
+}
+
+int main(int argc, char **argv) {
+    long num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    SweepRange friction = {0.70, 0.95, 0.05};
+    SweepRange attraction = {0.02, 0.20, 0.02};
+    const char *path = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "j:f:a:")) != -1) {
+        if (opt == 'j' && atoi(optarg) > 0) {
+            num_threads = atoi(optarg);
+        } else if (!(opt == 'f' && parse_range(optarg, &friction)) && !(opt == 'a' && parse_range(optarg, &attraction))) {
+            fprintf(stderr, "usage: %s [-j threads] [-f from:to:step] [-a from:to:step] [trace]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (optind < argc) {
+        path = argv[optind];
+    }
+
+    SensorTrace *synthetic = NULL;
+    uint8_t *file_data = NULL;
+    SensorTraceReader reader;
+    if (path) {
+        file_data = host_load_sensor_trace(path, &s_trace_size);
+        s_trace = file_data;
+    } else {
+        synthetic = create_synthetic_trace();
+        s_trace = sensor_trace_get_data(synthetic, &s_trace_size);
+    }
+    if (!s_trace || !sensor_trace_reader_init(&reader, s_trace, s_trace_size)) {
+        fprintf(stderr, "%s: no sensor trace found\n", path);
+        return 1;
+    }
+
+    const uint32_t num_friction = range_count(&friction);
+    const uint32_t num_attraction = range_count(&attraction);
+    s_num_jobs = num_friction * num_attraction;
+    s_jobs = calloc(s_num_jobs, sizeof(SweepJob));
+    for (uint32_t f = 0; f < num_friction; f++) {
+        for (uint32_t a = 0; a < num_attraction; a++) {
+            SweepJob *job = &s_jobs[f * num_attraction + a];
+            job->friction = DATA_PROVIDER_FIXED_FROM_FLOAT(friction.from + f * friction.step);
+            job->attraction = DATA_PROVIDER_FIXED_FROM_FLOAT(attraction.from + a * attraction.step);
+        }
+    }
+
+    if (num_threads > s_num_jobs) {
+        num_threads = s_num_jobs;
+    } else if (num_threads < 1) {
+        num_threads = 1;
+    }
+    const uint64_t start_ns = host_clock_ns();
+    pthread_t *threads = calloc((size_t) num_threads, sizeof(pthread_t));
+    for (long i = 0; i < num_threads; i++) {
+        pthread_create(&threads[i], NULL, run_jobs, NULL);
+    }
+    for (long i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    const double wall_ms = (host_clock_ns() - start_ns) / 1e6;
+
+    printf("%u pairs, %.0f s of virtual time each, %ld threads, %.0f ms\n",
+           (unsigned int) s_num_jobs, s_jobs[0].duration_ms / 1000.0, num_threads, wall_ms);
+    printf("%9s %10s %7s %10s %10s %10s %10s %10s %10s\n",
+           "friction", "attraction", "turns", "settle ms", "max ms", "overshoot", "jitter", "updates/m", "compass/m");
+    for (uint32_t i = 0; i < s_num_jobs; i++) {
+        const SweepJob *job = &s_jobs[i];
+        const double minutes = job->duration_ms / 60000.0;
+        const double f = DATA_PROVIDER_FIXED_TO_FLOAT(job->friction);
+        const double a = DATA_PROVIDER_FIXED_TO_FLOAT(job->attraction);
+        const bool is_default = fabs(f - SWEEP_DEFAULT_FRICTION) < 0.001 && fabs(a - SWEEP_DEFAULT_ATTRACTION) < 0.001;
+        char turns[16];
+        snprintf(turns, sizeof(turns), "%u%s", (unsigned int) job->num_turns, job->num_unsettled_turns ? "+" : "");
+        printf("%9.3f %10.3f %7s %10.0f %10.0f %10.2f %10.3f %10.0f %10.0f%s\n",
+               f, a, turns,
+               job->num_turns ? job->settle_ms_sum / job->num_turns : 0, job->settle_ms_max,
+               job->num_turns ? job->overshoot_sum / job->num_turns : 0,
+               job->num_jitter_samples ? sqrt(job->jitter_square_sum / job->num_jitter_samples) : 0,
+               job->num_updates / minutes, job->num_compass_callbacks / minutes,
+               is_default ? "  *" : "");
+    }
+
+    free(threads);
+    free(s_jobs);
+    free(file_data);
+    sensor_trace_destroy(synthetic);
+    return 0;
+}
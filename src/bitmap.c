@@ -1,6 +1,47 @@
 #include <pebble.h>
 #include "bitmap.h"
 
+#define MIN(X, Y) ((X) < (Y) ? (X) : (Y))
+#define MAX(X, Y) ((X) > (Y) ? (X) : (Y))
+
+// palettized formats pack 8 / bits pixels into a byte, the leftmost pixel in the most significant bits
+static int bits_per_pixel(GBitmapFormat bitmap_format) {
+  switch(bitmap_format) {
+    case GBitmapFormat1Bit :
+    case GBitmapFormat1BitPalette :
+      return 1;
+    case GBitmapFormat2BitPalette :
+      return 2;
+    case GBitmapFormat4BitPalette :
+      return 4;
+    default :
+      return 8;
+  }
+}
+
+static uint8_t get_palette_index(const uint8_t *data, int bits, int x) {
+  const int pixels_per_byte = 8 / bits;
+  const int shift = 8 - bits * (x % pixels_per_byte + 1);
+  return (uint8_t) ((data[x / pixels_per_byte] >> shift) & ((1 << bits) - 1));
+}
+
+static void set_palette_index(uint8_t *data, int bits, int x, uint8_t index) {
+  const int pixels_per_byte = 8 / bits;
+  const int shift = 8 - bits * (x % pixels_per_byte + 1);
+  const uint8_t mask = (uint8_t) (((1 << bits) - 1) << shift);
+  data[x / pixels_per_byte] = (uint8_t) ((data[x / pixels_per_byte] & ~mask) | ((index << shift) & mask));
+}
+
+// -1 if the palette doesn't contain color
+static int find_palette_index(GBitmap *bitmap, int bits, GColor color) {
+  for (int i = 0; i < (1 << bits); i++) {
+    if (gcolor_equal(get_bitmap_color_from_palette_index(bitmap, (uint8_t) i), color)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
 void set_bitmap_pixel_color(GBitmap *bitmap, GBitmapFormat bitmap_format, int y, int x, GColor color) {
   GRect bounds = gbitmap_get_bounds(bitmap);
   if (y < 0 || y >= bounds.size.h) {
@@ -14,14 +55,16 @@ void set_bitmap_pixel_color(GBitmap *bitmap, GBitmapFormat bitmap_format, int y,
         row.data[x / 8] ^= (-(gcolor_equal(color, GColorWhite)? 1 : 0) ^ row.data[x / 8]) & (1 << (x % 8));
         break;
       case GBitmapFormat1BitPalette :
-        //TODO
-        break;
       case GBitmapFormat2BitPalette :
-        //TODO
-        break;
-      case GBitmapFormat4BitPalette :
-        //TODO
+      case GBitmapFormat4BitPalette : {
+        // colors that aren't part of the palette can't be represented
+        const int bits = bits_per_pixel(bitmap_format);
+        const int index = find_palette_index(bitmap, bits, color);
+        if (index >= 0) {
+          set_palette_index(row.data, bits, x, (uint8_t) index);
+        }
         break;
+      }
       case GBitmapFormat8BitCircular :
       case GBitmapFormat8Bit :
         row.data[x] = color.argb;
@@ -40,14 +83,323 @@ GColor get_bitmap_pixel_color(GBitmap *bitmap, GBitmapFormat bitmap_format, int
     case GBitmapFormat1Bit :
       return ((row.data[x / 8] >> (x % 8)) & 1) == 1 ? GColorWhite : GColorBlack;
     case GBitmapFormat1BitPalette :
-      return get_bitmap_color_from_palette_index(bitmap, ((row.data[x / 8] << (x % 8)) & 128) == 128 ? 1 : 0);
     case GBitmapFormat2BitPalette :
-      return GColorBlack; //TODO get_color_from_palette_index(bitmap, (row.data[x / 4] >> (x % 4)) & 3);
     case GBitmapFormat4BitPalette :
-      return GColorBlack; //TODO
+      return get_bitmap_color_from_palette_index(bitmap, get_palette_index(row.data, bits_per_pixel(bitmap_format), x));
     case GBitmapFormat8BitCircular :
     case GBitmapFormat8Bit :
       return (GColor) {.argb = row.data[x] };
   }
   return GColorClear;
 }
+
+// -----
+// row span kernels, see bitmap.h
+
+// 32 bits of mask, starting at bit offset (which might be negative), limited to width
+static uint32_t span_mask_word(const uint32_t *mask, int width, int offset) {
+  uint32_t result;
+  if (offset >= 0) {
+    result = mask ? mask[offset / 32] >> (offset % 32) : 0xFFFFFFFF;
+    if (mask && offset % 32 && offset / 32 + 1 < (width + 31) / 32) {
+      result |= mask[offset / 32 + 1] << (32 - offset % 32);
+    }
+  } else {
+    result = (mask ? mask[0] : 0xFFFFFFFF) << -offset;
+  }
+  // clear bits beyond width
+  const int remaining = width - offset;
+  if (remaining < 32) {
+    result &= remaining > 0 ? (0xFFFFFFFF >> (32 - remaining)) : 0;
+  }
+  return result;
+}
+
+// clips [x, x + width) to the row, returns false if nothing is left
+static bool clip_span(GBitmap *bitmap, int y, int x, int width, GBitmapDataRowInfo *row, int *x0, int *x1) {
+  GRect bounds = gbitmap_get_bounds(bitmap);
+  if (y < 0 || y >= bounds.size.h || width <= 0) {
+    return false;
+  }
+  *row = gbitmap_get_data_row_info(bitmap, y);
+  *x0 = MAX(x, row->min_x);
+  *x1 = MIN(x + width - 1, row->max_x);
+  return *x0 <= *x1;
+}
+
+// spreads the lowest 4 bits to the 4 bytes of a word: 0b0101 -> 0x00FF00FF
+static uint32_t spread_nibble(uint32_t bits) {
+  return (((bits & 0xF) * 0x00204081) & 0x01010101) * 0xFF;
+}
+
+// 0xFF in every byte of word that equals value
+static uint32_t equal_bytes(uint32_t word, uint8_t value) {
+  const uint32_t x = word ^ (value * 0x01010101u);
+  const uint32_t zero_high_bits = ~(((x & 0x7F7F7F7F) + 0x7F7F7F7F) | x | 0x7F7F7F7F);
+  return (zero_high_bits >> 7) * 0xFF;
+}
+
+static uint32_t load32(const uint8_t *p) {
+  uint32_t result;
+  memcpy(&result, p, sizeof(result));
+  return result;
+}
+
+static void store32(uint8_t *p, uint32_t value) {
+  memcpy(p, &value, sizeof(value));
+}
+
+// returns the new value of a word of pixels, apply_*() only write back the selected pixels
+typedef uint32_t (*SpanOp)(uint32_t word, const void *context);
+
+// 32 pixels of a 1-bit row at a time
+
+static void apply_1bit(GBitmapDataRowInfo row, int x, int width, const uint32_t *mask, int x0, int x1,
+                       SpanOp op, const void *context) {
+  // 1-bit rows are word aligned, bit n of a little endian word is pixel n
+  for (int wx = x0 & ~31; wx <= x1; wx += 32) {
+    uint32_t selected = span_mask_word(mask, width, wx - x);
+    if (wx < x0) selected &= 0xFFFFFFFF << (x0 - wx);
+    if (wx + 31 > x1) selected &= 0xFFFFFFFF >> (wx + 31 - x1);
+    if (!selected) continue;
+
+    uint8_t *p = row.data + wx / 8;
+    const uint32_t word = load32(p);
+    store32(p, (op(word, context) & selected) | (word & ~selected));
+  }
+}
+
+// 4 pixels of an 8-bit row at a time
+
+static void apply_8bit(GBitmapDataRowInfo row, int x, int width, const uint32_t *mask, int x0, int x1,
+                       SpanOp op, const void *context) {
+  int px = x0;
+  for (; px + 3 <= x1; px += 4) {
+    const uint32_t selected = spread_nibble(span_mask_word(mask, width, px - x));
+    if (!selected) continue;
+
+    uint8_t *p = row.data + px;
+    const uint32_t word = load32(p);
+    store32(p, (op(word, context) & selected) | (word & ~selected));
+  }
+  // remaining pixels of the span
+  if (px <= x1) {
+    uint32_t selected = spread_nibble(span_mask_word(mask, width, px - x) & (0xF >> (3 - (x1 - px))));
+    uint8_t bytes[4] = {0};
+    memcpy(bytes, row.data + px, (size_t) (x1 - px + 1));
+    const uint32_t word = load32(bytes);
+    store32(bytes, (op(word, context) & selected) | (word & ~selected));
+    memcpy(row.data + px, bytes, (size_t) (x1 - px + 1));
+  }
+}
+
+static bool is_8bit(GBitmapFormat format) {
+  return format == GBitmapFormat8Bit || format == GBitmapFormat8BitCircular;
+}
+
+static bool is_selected(const uint32_t *mask, int i) {
+  return !mask || (mask[i / 32] >> (i % 32)) & 1;
+}
+
+static uint32_t invert_1bit(uint32_t word, const void *context) {
+  return ~word;
+}
+
+static uint32_t invert_8bit(uint32_t word, const void *context) {
+  // flip the color bits, keep alpha
+  return word ^ 0x3F3F3F3F;
+}
+
+void bitmap_invert_span(GBitmap *bitmap, GBitmapFormat bitmap_format, int y, int x, int width, const uint32_t *mask) {
+  GBitmapDataRowInfo row;
+  int x0, x1;
+  if (!clip_span(bitmap, y, x, width, &row, &x0, &x1)) return;
+
+  if (bitmap_format == GBitmapFormat1Bit) {
+    apply_1bit(row, x, width, mask, x0, x1, invert_1bit, NULL);
+  } else if (is_8bit(bitmap_format)) {
+    apply_8bit(row, x, width, mask, x0, x1, invert_8bit, NULL);
+  } else {
+    for (int px = x0; px <= x1; px++) {
+      if (!is_selected(mask, px - x)) continue;
+      GColor color = get_bitmap_pixel_color(bitmap, bitmap_format, y, px);
+      color.argb ^= 0x3F;
+      set_bitmap_pixel_color(bitmap, bitmap_format, y, px, color);
+    }
+  }
+}
+
+static uint32_t fill(uint32_t word, const void *context) {
+  return *(const uint32_t *) context;
+}
+
+void bitmap_mask_blit_span(GBitmap *bitmap, GBitmapFormat bitmap_format, int y, int x, int width, const uint32_t *mask, GColor color) {
+  GBitmapDataRowInfo row;
+  int x0, x1;
+  if (!clip_span(bitmap, y, x, width, &row, &x0, &x1)) return;
+
+  if (bitmap_format == GBitmapFormat1Bit) {
+    const uint32_t word = gcolor_equal(color, GColorWhite) ? 0xFFFFFFFF : 0;
+    apply_1bit(row, x, width, mask, x0, x1, fill, &word);
+  } else if (is_8bit(bitmap_format)) {
+    const uint32_t word = color.argb * 0x01010101u;
+    apply_8bit(row, x, width, mask, x0, x1, fill, &word);
+  } else {
+    for (int px = x0; px <= x1; px++) {
+      if (is_selected(mask, px - x)) {
+        set_bitmap_pixel_color(bitmap, bitmap_format, y, px, color);
+      }
+    }
+  }
+}
+
+typedef struct {
+  uint32_t match;
+  uint32_t if_match;
+  uint32_t otherwise;
+} RecolorContext;
+
+static uint32_t recolor_1bit(uint32_t word, const void *context) {
+  const RecolorContext *c = context;
+  // match is all ones for white, all zeros for black
+  const uint32_t equal = ~(word ^ c->match);
+  return (equal & c->if_match) | (~equal & c->otherwise);
+}
+
+static uint32_t recolor_8bit(uint32_t word, const void *context) {
+  const RecolorContext *c = context;
+  const uint32_t equal = equal_bytes(word, (uint8_t) c->match);
+  return (equal & c->if_match) | (~equal & c->otherwise);
+}
+
+void bitmap_recolor_span(GBitmap *bitmap, GBitmapFormat bitmap_format, int y, int x, int width, const uint32_t *mask,
+                         GColor match, GColor if_match, GColor otherwise) {
+  GBitmapDataRowInfo row;
+  int x0, x1;
+  if (!clip_span(bitmap, y, x, width, &row, &x0, &x1)) return;
+
+  if (bitmap_format == GBitmapFormat1Bit && (gcolor_equal(match, GColorWhite) || gcolor_equal(match, GColorBlack))) {
+    const RecolorContext context = {
+      .match = gcolor_equal(match, GColorWhite) ? 0xFFFFFFFF : 0,
+      .if_match = gcolor_equal(if_match, GColorWhite) ? 0xFFFFFFFF : 0,
+      .otherwise = gcolor_equal(otherwise, GColorWhite) ? 0xFFFFFFFF : 0,
+    };
+    apply_1bit(row, x, width, mask, x0, x1, recolor_1bit, &context);
+  } else if (is_8bit(bitmap_format)) {
+    const RecolorContext context = {
+      .match = match.argb,
+      .if_match = if_match.argb * 0x01010101u,
+      .otherwise = otherwise.argb * 0x01010101u,
+    };
+    apply_8bit(row, x, width, mask, x0, x1, recolor_8bit, &context);
+  } else {
+    for (int px = x0; px <= x1; px++) {
+      if (!is_selected(mask, px - x)) continue;
+      const GColor color = get_bitmap_pixel_color(bitmap, bitmap_format, y, px);
+      set_bitmap_pixel_color(bitmap, bitmap_format, y, px, gcolor_equal(color, match) ? if_match : otherwise);
+    }
+  }
+}
+
+// per byte lookup table for bitmap_get_span_mask(), bit n is set if the n-th pixel of the byte has a matching color
+// the cross hair uses the same table for every row, so it's only rebuilt if format or matching palette entries change
+typedef struct {
+  bool valid;
+  GBitmapFormat format;
+  uint16_t matching_indices;
+  uint8_t bits[256];
+} SpanMaskLookup;
+
+static SpanMaskLookup s_span_mask_lookup;
+
+static const uint8_t *span_mask_lookup(GBitmapFormat bitmap_format, uint16_t matching_indices) {
+  SpanMaskLookup *lookup = &s_span_mask_lookup;
+  if (lookup->valid && lookup->format == bitmap_format && lookup->matching_indices == matching_indices) {
+    return lookup->bits;
+  }
+
+  const int bits = bits_per_pixel(bitmap_format);
+  const int pixels_per_byte = 8 / bits;
+  for (int value = 0; value < 256; value++) {
+    uint8_t result = 0;
+    for (int p = 0; p < pixels_per_byte; p++) {
+      // unlike palettized formats, 1-bit frame buffers store their leftmost pixel in the least significant bit
+      const int index = bitmap_format == GBitmapFormat1Bit ? (value >> p) & 1 : (value >> (8 - bits * (p + 1))) & ((1 << bits) - 1);
+      if ((matching_indices >> index) & 1) {
+        result |= 1 << p;
+      }
+    }
+    lookup->bits[value] = result;
+  }
+  lookup->valid = true;
+  lookup->format = bitmap_format;
+  lookup->matching_indices = matching_indices;
+  return lookup->bits;
+}
+
+void bitmap_get_span_mask(GBitmap *bitmap, GBitmapFormat bitmap_format, int y, int x, int width, GColor color, uint32_t *mask) {
+  const int words = (width + 31) / 32;
+  if (words <= 0) return;
+  memset(mask, 0, sizeof(uint32_t) * (size_t) words);
+  GBitmapDataRowInfo row = gbitmap_get_data_row_info(bitmap, y);
+
+  const int bits = bits_per_pixel(bitmap_format);
+  if (bits == 8) {
+    for (int i = 0; i < width; i++) {
+      if (gcolor_equal(get_bitmap_pixel_color(bitmap, bitmap_format, y, x + i), color)) {
+        mask[i / 32] |= 1u << (i % 32);
+      }
+    }
+    return;
+  }
+
+  // which palette indices (or for 1-bit: black and white) represent color
+  uint16_t matching_indices = 0;
+  if (bitmap_format == GBitmapFormat1Bit) {
+    matching_indices = (uint16_t) ((gcolor_equal(color, GColorBlack) ? 1 : 0) | (gcolor_equal(color, GColorWhite) ? 2 : 0));
+  } else {
+    for (int i = 0; i < (1 << bits); i++) {
+      if (gcolor_equal(get_bitmap_color_from_palette_index(bitmap, (uint8_t) i), color)) {
+        matching_indices |= 1 << i;
+      }
+    }
+  }
+  if (!matching_indices) return;
+  const uint8_t *lookup = span_mask_lookup(bitmap_format, matching_indices);
+
+  // a whole byte of source pixels at a time, pos is the position of its first pixel in mask
+  const int pixels_per_byte = 8 / bits;
+  for (int b = x / pixels_per_byte; b <= (x + width - 1) / pixels_per_byte; b++) {
+    uint32_t byte_bits = lookup[row.data[b]];
+    int pos = b * pixels_per_byte - x;
+    if (pos < 0) {
+      byte_bits >>= -pos;
+      pos = 0;
+    }
+    mask[pos / 32] |= byte_bits << (pos % 32);
+    if (pos % 32 + pixels_per_byte > 32 && pos / 32 + 1 < words) {
+      mask[pos / 32 + 1] |= byte_bits >> (32 - pos % 32);
+    }
+  }
+  // clear bits beyond width
+  if (width % 32) {
+    mask[width / 32] &= 0xFFFFFFFF >> (32 - width % 32);
+  }
+}
+
+void bitmap_copy_rows(GBitmap *dest, int dest_first_row, GBitmap *src, int src_first_row, GBitmapFormat bitmap_format, int num_rows) {
+  const int bits = bits_per_pixel(bitmap_format);
+  const int first = MAX(0, MAX(-dest_first_row, -src_first_row));
+  const int last = MIN(num_rows, MIN(gbitmap_get_bounds(dest).size.h - dest_first_row, gbitmap_get_bounds(src).size.h - src_first_row)) - 1;
+  for (int i = first; i <= last; i++) {
+    const GBitmapDataRowInfo dest_row = gbitmap_get_data_row_info(dest, dest_first_row + i);
+    const GBitmapDataRowInfo src_row = gbitmap_get_data_row_info(src, src_first_row + i);
+    const int x0 = MAX(dest_row.min_x, src_row.min_x);
+    const int x1 = MIN(dest_row.max_x, src_row.max_x);
+    if (x0 > x1) continue;
+    // whole bytes, rows of the same geometry share the pixels packed into them
+    const int first_byte = x0 * bits / 8;
+    const int last_byte = (x1 * bits + bits - 1) / 8;
+    memcpy(dest_row.data + first_byte, src_row.data + first_byte, (size_t) (last_byte - first_byte + 1));
+  }
+}
@@ -15,3 +15,25 @@ GColor get_bitmap_color_from_palette_index(GBitmap *bitmap, uint8_t index);
 GColor get_bitmap_pixel_color(GBitmap *bitmap, GBitmapFormat bitmap_format, int y, int x);
 
 void set_bitmap_pixel_color(GBitmap *bitmap, GBitmapFormat bitmap_format, int y, int x, GColor color);
+
+// row span kernels, operate on the pixels x .. x + width - 1 of row y
+// they fetch the row info once and process 1-bit rows 32 and 8-bit rows 4 pixels at a time
+// mask selects the pixels to change, bit i for pixel x + i, NULL selects all of them
+
+//! inverts the color of the selected pixels, black <-> white
+void bitmap_invert_span(GBitmap *bitmap, GBitmapFormat bitmap_format, int y, int x, int width, const uint32_t *mask);
+
+//! sets the selected pixels to color
+void bitmap_mask_blit_span(GBitmap *bitmap, GBitmapFormat bitmap_format, int y, int x, int width, const uint32_t *mask, GColor color);
+
+//! sets the selected pixels to if_match where they equal match and to otherwise everywhere else
+void bitmap_recolor_span(GBitmap *bitmap, GBitmapFormat bitmap_format, int y, int x, int width, const uint32_t *mask,
+                         GColor match, GColor if_match, GColor otherwise);
+
+//! fills mask, (width + 31) / 32 words, with the pixels x .. x + width - 1 of row y that equal color
+void bitmap_get_span_mask(GBitmap *bitmap, GBitmapFormat bitmap_format, int y, int x, int width, GColor color, uint32_t *mask);
+
+//! copies num_rows rows starting at src_first_row in src to the rows starting at dest_first_row in dest,
+//! both need the same number of bits per pixel and the same x origin
+//! only the pixels both rows have in common are copied, e.g. for 8-bit frame buffers of round displays
+void bitmap_copy_rows(GBitmap *dest, int dest_first_row, GBitmap *src, int src_first_row, GBitmapFormat bitmap_format, int num_rows);
@@ -30,6 +30,16 @@ static void fake_calibration_window(void) {
 
 #endif
 
+// uncomment this line to record the sensor callbacks, the trace is written to the log on exit
+// "pebble logs > session.log" captures it, replay it with "build/host/basalt/replay session.log"
+//#define RECORD_SENSOR_TRACE
+
+#ifdef RECORD_SENSOR_TRACE
+// a minute of use takes about 12KB, most of it accelerometer samples
+static const size_t SENSOR_TRACE_CAPACITY = PBL_IF_COLOR_ELSE(24 * 1024, 6 * 1024);
+static SensorTrace *sensor_trace;
+#endif
+
 static void init(void) {
 #ifdef DEMO_CALIBRATION_MODE
     calibration_window = compass_calibration_window_create();
@@ -40,6 +50,11 @@ static void init(void) {
     compass_window = compass_window_create();
 
     window_stack_push(compass_window_get_window(compass_window), true);
+
+#ifdef RECORD_SENSOR_TRACE
+    sensor_trace = sensor_trace_create(SENSOR_TRACE_CAPACITY);
+    data_provider_set_sensor_trace(compass_window_get_data_provider(compass_window), sensor_trace);
+#endif
 #endif
 }
 
@@ -47,6 +62,13 @@ static void deinit(void) {
 #ifdef DEMO_CALIBRATION_MODE
     compass_calibration_window_destroy(calibration_window);
 #else
+#ifdef RECORD_SENSOR_TRACE
+    data_provider_set_sensor_trace(compass_window_get_data_provider(compass_window), NULL);
+    if(sensor_trace) {
+        sensor_trace_log(sensor_trace);
+        sensor_trace_destroy(sensor_trace);
+    }
+#endif
     compass_window_destroy(compass_window);
 #endif
 }
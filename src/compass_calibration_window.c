@@ -1,18 +1,47 @@
 #include "compass_calibration_window.h"
+#include "bitmap.h"
 
-#define CALIBRATION_NUM_SEGMENTS 80
+// resolution of the ring, see compass_calibration_window_set_num_segments()
+#define CALIBRATION_MAX_SEGMENTS 80
+#define CALIBRATION_MIN_SEGMENTS 8
+
+// as we don't have a graphics_fill_ring_segment() we fake a circle here
+// in reality we are painting and filling a regular polygon, these are its corners
+typedef struct {
+    GPoint inner;
+    GPoint mid;
+    GPoint outer;
+} CompassCalibrationWindowHelperPoint;
 
 typedef struct {
     // actual ring, custom update_proc
     Layer *indicator_layer;
 
+    // ring geometry, depends on the bounds of indicator_layer only and is computed in window_load()
+    GRect ring_bounds;
+    GPoint ring_center;
+    int16_t ring_inner_radius;
+    CompassCalibrationWindowHelperPoint ring_points[CALIBRATION_MAX_SEGMENTS];
+
+    // finished ring without the ball, NULL if there wasn't enough memory to keep one, see draw_indicator()
+    GBitmap *ring_cache;
+    bool ring_cache_valid;
+    // level of each segment as drawn into ring_cache and the segments whose level changed since
+    uint8_t segment_drawn_level[CALIBRATION_MAX_SEGMENTS];
+    uint32_t damaged_segments[(CALIBRATION_MAX_SEGMENTS + 31) / 32];
+
     TextLayer *headline_layer;
     TextLayer *description_layer;
+    // progress the text layers currently show, see update_description_if_needed()
+    uint8_t shown_progress;
 
     bool influenced_by_interference;
 
     // internal state
-    uint8_t segment_value[CALIBRATION_NUM_SEGMENTS];
+    uint8_t num_segments;
+    uint8_t segment_value[CALIBRATION_MAX_SEGMENTS];
+    // number of segments at each CalibrationSegmentLevel, kept up to date by set_segment_value()
+    uint8_t num_segments_at_level[4];
     int32_t current_angle;
 
     CompassCalibrationWindowHandler back_button_handler;
@@ -26,10 +55,51 @@ static const int CALIBRATION_THRESHOLD_FILLED = 150;
 
 static const int CALIBRATION_WINDOW_RING_MARGIN = 0;
 
+// what a segment looks like, each level adds to the previous one
+typedef enum {
+    CalibrationSegmentLevelNone,
+    CalibrationSegmentLevelVisited, // outer arc and spokes
+    CalibrationSegmentLevelMid,     // half filled
+    CalibrationSegmentLevelFilled,
+} CalibrationSegmentLevel;
+
+static CalibrationSegmentLevel segment_level(uint8_t value) {
+    if (value >= CALIBRATION_THRESHOLD_FILLED) return CalibrationSegmentLevelFilled;
+    if (value >= CALIBRATION_THRESHOLD_MID) return CalibrationSegmentLevelMid;
+    if (value >= CALIBRATION_THRESHOLD_VISITED) return CalibrationSegmentLevelVisited;
+    return CalibrationSegmentLevelNone;
+}
+
 static char *const INITIAL_HEADLINE = "Calibration";
 static char *const INITIAL_DESCRIPTION = "Tilt Pebble to\nroll ball around";
 
-static void _gpath_draw_filled(GContext* ctx, GPath* path) ;
+// what the text layers say
+typedef enum {
+    CalibrationProgressInterference,
+    CalibrationProgressInitial,  // not all segments have been visited yet
+    CalibrationProgressTiltMore, // all segments have been visited, encourage user to tilt more!
+    CalibrationProgressDone,     // all segments are fully filled
+} CalibrationProgress;
+
+static const struct {
+    char *headline;
+    char *description;
+} PROGRESS_TEXTS[] = {
+    [CalibrationProgressInterference] = {"Interference", "Please unplug\nthe charger."},
+    [CalibrationProgressInitial] = {INITIAL_HEADLINE, INITIAL_DESCRIPTION},
+    [CalibrationProgressTiltMore] = {"Tilt more!", "Fill the ring\ncompletely"},
+    [CalibrationProgressDone] = {"More!", "Try a fancy\ndance?"},
+};
+
+// a segment of the ring, filled by fill_quads()
+typedef struct {
+    GPoint points[4];
+} CompassCalibrationWindowQuad;
+
+// fill_quads() handles this many quads at once
+#define CALIBRATION_MAX_QUADS_PER_FILL 20
+
+static void fill_quads(GContext *ctx, const CompassCalibrationWindowQuad *quads, int num_quads, GRect clip);
 
 #define MIN(X, Y) ((X) < (Y) ? (X) : (Y))
 #define MAX(X, Y) ((X) > (Y) ? (X) : (Y))
@@ -42,48 +112,35 @@ void compass_calibration_window_set_current_angle(CompassCalibrationWindow *wind
     layer_mark_dirty(window_get_root_layer(w));
 }
 
+static CalibrationProgress calibration_progress(const CompassCalibrationWindowData *data) {
+    if (data->influenced_by_interference) return CalibrationProgressInterference;
+    if (data->num_segments_at_level[CalibrationSegmentLevelNone] > 0) return CalibrationProgressInitial;
+    if (data->num_segments_at_level[CalibrationSegmentLevelFilled] < data->num_segments) return CalibrationProgressTiltMore;
+    return CalibrationProgressDone;
+}
+
 static void update_description_if_needed(CompassCalibrationWindowData *data) {
-    if(!data->headline_layer) return;
+    if(!data->headline_layer || !data->description_layer) return;
 
-    char *headline = NULL;
-    char *description = NULL;
+    // the texts only change with the progress, which only changes if a segment reaches a new level
+    const CalibrationProgress progress = calibration_progress(data);
+    if (progress == data->shown_progress) return;
 
-    if(data->influenced_by_interference) {
-        headline = "Interference";
-        description = "Please unplug\nthe charger.";
-    } else {
-        bool all_fully_filled = true;
-        for (int i = 0; i < CALIBRATION_NUM_SEGMENTS; i++) {
-            if (data->segment_value[i] < CALIBRATION_THRESHOLD_VISITED) {
-                headline = INITIAL_HEADLINE;
-                description = INITIAL_DESCRIPTION;
-                break;
-            }
-            if (data->segment_value[i] < CALIBRATION_THRESHOLD_FILLED) {
-                all_fully_filled = false;
-            }
-        }
+    data->shown_progress = (uint8_t) progress;
+    text_layer_set_text(data->headline_layer, PROGRESS_TEXTS[progress].headline);
+    text_layer_set_text(data->description_layer, PROGRESS_TEXTS[progress].description);
+}
 
-        if (headline == NULL) {
-            if (all_fully_filled) {
-                headline = "More!";
-                description = "Try a fancy\ndance?";
-            } else {
-                // all segments have been visited, encourage user to tilt more!
-                headline = "Tilt more!";
-                description = "Fill the ring\ncompletely";
-            }
-        }
-    }
+// returns true if the segment reached a new level
+static bool set_segment_value(CompassCalibrationWindowData *data, int segment, uint8_t value) {
+    const CalibrationSegmentLevel old_level = segment_level(data->segment_value[segment]);
+    const CalibrationSegmentLevel new_level = segment_level(value);
+    data->segment_value[segment] = value;
+    if (old_level == new_level) return false;
 
-    // try to minimize updates
-    // should Pebble's applib do this itself?
-    if(strcmp(headline, text_layer_get_text(data->headline_layer))) {
-        text_layer_set_text(data->headline_layer, headline);
-    }
-    if(strcmp(description, text_layer_get_text(data->description_layer))) {
-        text_layer_set_text(data->description_layer, description);
-    }
+    data->num_segments_at_level[old_level]--;
+    data->num_segments_at_level[new_level]++;
+    return true;
 }
 
 void compass_calibration_window_merge_value(CompassCalibrationWindow *window, int32_t angle, uint8_t intensity) {
@@ -94,12 +151,20 @@ void compass_calibration_window_merge_value(CompassCalibrationWindow *window, in
         return;
     }
 
-    int segment = (angle * CALIBRATION_NUM_SEGMENTS / TRIG_MAX_ANGLE) % CALIBRATION_NUM_SEGMENTS;
+    int segment = (angle * data->num_segments / TRIG_MAX_ANGLE) % data->num_segments;
     if(data->segment_value[segment] < intensity) {
-        data->segment_value[segment] = intensity;
-        layer_mark_dirty(window_get_root_layer(w));
+        const bool was_mid = segment_level(data->segment_value[segment]) == CalibrationSegmentLevelMid;
+        // the ring and the texts only change if the segment reaches a new level
+        if (set_segment_value(data, segment, intensity)) {
+            data->damaged_segments[segment / 32] |= 1u << (segment % 32);
+            // the rasterized half filled quad isn't entirely inside the filled one, it can't be drawn over
+            if (was_mid) {
+                data->ring_cache_valid = false;
+            }
+            layer_mark_dirty(window_get_root_layer(w));
+            update_description_if_needed(data);
+        }
     }
-    update_description_if_needed(data);
 }
 
 void compass_calibration_window_apply_accel_data(CompassCalibrationWindow *calibration_window, AccelData accel_data) {
@@ -114,12 +179,16 @@ void compass_calibration_window_apply_accel_data(CompassCalibrationWindow *calib
 
 static void reset_segment_data(CompassCalibrationWindowData *data, bool fill_with_fake_data) {
     memset(&data->segment_value, 0, sizeof(data->segment_value));
+    memset(&data->num_segments_at_level, 0, sizeof(data->num_segments_at_level));
+    data->num_segments_at_level[CalibrationSegmentLevelNone] = data->num_segments;
+    // segments only grow, after a reset the whole ring needs to be drawn again
+    data->ring_cache_valid = false;
 
     if(fill_with_fake_data) {
-        int b = CALIBRATION_NUM_SEGMENTS * 6 / 10;
-        data->segment_value[b+0] = CALIBRATION_THRESHOLD_VISITED;
-        data->segment_value[b+1] = CALIBRATION_THRESHOLD_MID;
-        data->segment_value[b+2] = CALIBRATION_THRESHOLD_FILLED;
+        int b = data->num_segments * 6 / 10;
+        set_segment_value(data, b+0, CALIBRATION_THRESHOLD_VISITED);
+        set_segment_value(data, b+1, CALIBRATION_THRESHOLD_MID);
+        set_segment_value(data, b+2, CALIBRATION_THRESHOLD_FILLED);
     }
 }
 
@@ -157,10 +226,7 @@ static GPoint point_at_angle(GPoint center, int angle, int16_t radius) {
                   center.y + (int16_t)(cos_lookup(angle) * radius / TRIG_MAX_RATIO));
 }
 
-static void draw_indicator(Layer *layer, GContext* ctx) {
-    CompassCalibrationWindowData *data = *(CompassCalibrationWindowDataPtr*)layer_get_data(layer);
-
-    const GRect rect = layer_get_bounds(layer);
+static void update_ring_geometry(CompassCalibrationWindowData *data, GRect rect) {
     const uint16_t ring_thickness = 10;
     const uint16_t outer_radius = (uint16_t) (MIN(rect.size.h, rect.size.w) / 2);
     const uint16_t inner_radius = outer_radius - ring_thickness;
@@ -168,43 +234,88 @@ static void draw_indicator(Layer *layer, GContext* ctx) {
 
     const GPoint c = grect_center_point(&rect);
 
-    graphics_context_set_stroke_color(ctx, GColorWhite);
-    graphics_context_set_fill_color(ctx, PBL_IF_COLOR_ELSE(GColorRed, GColorWhite));
-
-    // as we don't have a graphics_fill_ring_segment() we fake a circle here
-    // in reality we are painting and filling a regular polygon
-    // helper points for rendering below
-    typedef struct {
-        GPoint inner;
-        GPoint mid;
-        GPoint outer;
-    } CompassCalibrationWindowHelperPoint;
-
-    CompassCalibrationWindowHelperPoint *points = malloc(sizeof(CompassCalibrationWindowHelperPoint) * CALIBRATION_NUM_SEGMENTS);
-    for (int s = 0; s < CALIBRATION_NUM_SEGMENTS; s++) {
+    data->ring_bounds = rect;
+    data->ring_center = c;
+    data->ring_inner_radius = (int16_t) inner_radius;
+    for (int s = 0; s < data->num_segments; s++) {
         // (s-0.5) * 360 / num_segments
-        int angle = (s * TRIG_MAX_ANGLE - TRIG_MAX_ANGLE / 2) / CALIBRATION_NUM_SEGMENTS;
-        points[s].inner = point_at_angle(c, angle, inner_radius);
-        points[s].mid = point_at_angle(c, angle, mid_radius);
-        points[s].outer = point_at_angle(c, angle, outer_radius);
+        int angle = (s * TRIG_MAX_ANGLE - TRIG_MAX_ANGLE / 2) / data->num_segments;
+        data->ring_points[s].inner = point_at_angle(c, angle, inner_radius);
+        data->ring_points[s].mid = point_at_angle(c, angle, mid_radius);
+        data->ring_points[s].outer = point_at_angle(c, angle, outer_radius);
+    }
+}
+
+void compass_calibration_window_set_num_segments(CompassCalibrationWindow *window, uint8_t num_segments) {
+    const Window *w = (Window*) window;
+    CompassCalibrationWindowData *data = window_get_user_data(w);
+
+    num_segments = MAX(CALIBRATION_MIN_SEGMENTS, MIN(num_segments, CALIBRATION_MAX_SEGMENTS));
+    if (num_segments == data->num_segments) {
+        return;
+    }
+    data->num_segments = num_segments;
+
+    // values were collected for other segments, start over
+    reset_segment_data(data, false);
+    if (data->indicator_layer) {
+        update_ring_geometry(data, layer_get_bounds(data->indicator_layer));
+        layer_mark_dirty(window_get_root_layer(w));
+    }
+    update_description_if_needed(data);
+}
+
+uint8_t compass_calibration_window_get_num_segments(CompassCalibrationWindow *window) {
+    CompassCalibrationWindowData *data = window_get_user_data((Window*)window);
+    return data->num_segments;
+}
+
+static CompassCalibrationWindowQuad segment_quad(const CompassCalibrationWindowData *data, int s, CalibrationSegmentLevel level) {
+    const CompassCalibrationWindowHelperPoint *points = data->ring_points;
+    const int s2 = (s + 1) % data->num_segments;
+    const bool filled = level == CalibrationSegmentLevelFilled;
+    return (CompassCalibrationWindowQuad) {{
+        points[s].inner,
+        filled ? points[s].outer : points[s].mid,
+        filled ? points[s2].outer : points[s2].mid,
+        points[s2].inner,
+    }};
+}
+
+// segments are filled in groups of CALIBRATION_MAX_QUADS_PER_FILL consecutive ones
+// fill_quads() rasterizes the union of a group, draw_damaged_segments() refills whole groups to get the same pixels
+#define CALIBRATION_MAX_FILL_GROUPS ((CALIBRATION_MAX_SEGMENTS + CALIBRATION_MAX_QUADS_PER_FILL - 1) / CALIBRATION_MAX_QUADS_PER_FILL)
+
+static int num_fill_groups(const CompassCalibrationWindowData *data) {
+    return (data->num_segments + CALIBRATION_MAX_QUADS_PER_FILL - 1) / CALIBRATION_MAX_QUADS_PER_FILL;
+}
+
+static void fill_group(CompassCalibrationWindowData *data, GContext *ctx, GRect rect, int group) {
+    CompassCalibrationWindowQuad quads[CALIBRATION_MAX_QUADS_PER_FILL];
+    int num_quads = 0;
+
+    const int first = group * CALIBRATION_MAX_QUADS_PER_FILL;
+    const int end = MIN(first + CALIBRATION_MAX_QUADS_PER_FILL, data->num_segments);
+    for (int s = first; s < end; s++) {
+        const CalibrationSegmentLevel level = segment_level(data->segment_value[s]);
+        if (level >= CalibrationSegmentLevelMid) {
+            quads[num_quads++] = segment_quad(data, s, level);
+        }
     }
+    fill_quads(ctx, quads, num_quads, rect);
+}
 
-    // we create a gpath only once and modify it one the fly
-    GPathInfo path_info = (GPathInfo) {
-            .num_points = 4,
-            .points = (GPoint[4]) {},
-    };
-    GPath *path = gpath_create(&path_info);
+// all lines first, then all quads on top
+// draw_damaged_segments() relies on this order to update the cached ring without drawing all of it
+static void draw_ring(CompassCalibrationWindowData *data, GContext *ctx, GRect rect) {
+    const CompassCalibrationWindowHelperPoint *points = data->ring_points;
 
     // go around the ring and draw elements as needed
-    for (int s = 0; s < CALIBRATION_NUM_SEGMENTS; s++) {
-        const int s2 = (s + 1) % CALIBRATION_NUM_SEGMENTS;
+    for (int s = 0; s < data->num_segments; s++) {
+        const int s2 = (s + 1) % data->num_segments;
         const uint8_t segment_value = data->segment_value[s];
-        const uint8_t next_segment_value = data->segment_value[s2];
         const bool segment_visited = segment_value >= CALIBRATION_THRESHOLD_VISITED;
-        const bool next_segment_visited = next_segment_value >= CALIBRATION_THRESHOLD_VISITED;
-        const bool segment_filled = segment_value >= CALIBRATION_THRESHOLD_FILLED;
-        const bool segment_mid = segment_value >= CALIBRATION_THRESHOLD_MID;
+        const bool next_segment_visited = data->segment_value[s2] >= CALIBRATION_THRESHOLD_VISITED;
 
         graphics_draw_line(ctx, points[s].inner, points[s2].inner);
         if (segment_visited) {
@@ -213,23 +324,105 @@ static void draw_indicator(Layer *layer, GContext* ctx) {
         if (segment_visited || next_segment_visited) {
             graphics_draw_line(ctx, points[s2].inner, points[s2].outer);
         }
-        if (segment_filled || segment_mid) {
-            path_info.points[0] = points[s].inner;
-            path_info.points[1] = segment_filled ? points[s].outer : points[s].mid;
-            path_info.points[2] = segment_filled ? points[s2].outer : points[s2].mid;
-            // gpath_draw_filled does not support changing .num_points after gpath has been created
-            // hence, put 4th point into 3rd
-            path_info.points[3] = points[s2].inner;
-//            gpath_draw_filled(ctx, path);
-            _gpath_draw_filled(ctx, path);
+        data->segment_drawn_level[s] = (uint8_t) segment_level(segment_value);
+    }
+    for (int g = 0; g < num_fill_groups(data); g++) {
+        fill_group(data, ctx, rect, g);
+    }
+    memset(data->damaged_segments, 0, sizeof(data->damaged_segments));
+}
+
+// draws what changed since the ring was cached on top of it
+// levels only grow, so only the lines that appear with a new level need to be drawn
+// new lines only touch the quads of their own segment and its neighbors, their groups are filled again afterwards
+static void draw_damaged_segments(CompassCalibrationWindowData *data, GContext *ctx, GRect rect) {
+    const CompassCalibrationWindowHelperPoint *points = data->ring_points;
+    bool refill[CALIBRATION_MAX_FILL_GROUPS] = {false};
+
+    for (int s = 0; s < data->num_segments; s++) {
+        if (!(data->damaged_segments[s / 32] & (1u << (s % 32)))) continue;
+
+        const int s0 = (s + data->num_segments - 1) % data->num_segments;
+        const int s2 = (s + 1) % data->num_segments;
+        const CalibrationSegmentLevel drawn = (CalibrationSegmentLevel) data->segment_drawn_level[s];
+        const CalibrationSegmentLevel level = segment_level(data->segment_value[s]);
+
+        if (drawn < CalibrationSegmentLevelVisited && level >= CalibrationSegmentLevelVisited) {
+            graphics_draw_line(ctx, points[s].outer, points[s2].outer);
+            // spokes are shared with the neighbors, they might be there already
+            if (data->segment_drawn_level[s0] < CalibrationSegmentLevelVisited) {
+                graphics_draw_line(ctx, points[s].inner, points[s].outer);
+            }
+            if (data->segment_drawn_level[s2] < CalibrationSegmentLevelVisited) {
+                graphics_draw_line(ctx, points[s2].inner, points[s2].outer);
+            }
         }
+        refill[s0 / CALIBRATION_MAX_QUADS_PER_FILL] = true;
+        refill[s / CALIBRATION_MAX_QUADS_PER_FILL] = true;
+        refill[s2 / CALIBRATION_MAX_QUADS_PER_FILL] = true;
+        data->segment_drawn_level[s] = (uint8_t) level;
     }
-    gpath_destroy(path);
-    free(points);
+    for (int g = 0; g < num_fill_groups(data); g++) {
+        if (refill[g]) {
+            fill_group(data, ctx, rect, g);
+        }
+    }
+    memset(data->damaged_segments, 0, sizeof(data->damaged_segments));
+}
 
-    // draw current angle
-    graphics_fill_circle(ctx, point_at_angle(c, data->current_angle, (int16_t) (inner_radius - 6)), 4);
+static bool has_damaged_segments(CompassCalibrationWindowData *data) {
+    for (unsigned int i = 0; i < ARRAY_LENGTH(data->damaged_segments); i++) {
+        if (data->damaged_segments[i]) return true;
+    }
+    return false;
+}
 
+static bool copy_ring_cache(GContext *ctx, Layer *layer, GBitmap *ring_cache, bool to_cache) {
+    GBitmap *frame_buffer = graphics_capture_frame_buffer(ctx);
+    if (!frame_buffer) return false;
+    // the indicator layer is a direct child of the window's root layer, ring_cache only holds its rows
+    const GRect frame = layer_get_frame(layer);
+    if (gbitmap_get_bounds(ring_cache).size.h < frame.size.h) {
+        graphics_release_frame_buffer(ctx, frame_buffer);
+        return false;
+    }
+    if (to_cache) {
+        bitmap_copy_rows(ring_cache, 0, frame_buffer, frame.origin.y, gbitmap_get_format(frame_buffer), frame.size.h);
+    } else {
+        bitmap_copy_rows(frame_buffer, frame.origin.y, ring_cache, 0, gbitmap_get_format(frame_buffer), frame.size.h);
+    }
+    graphics_release_frame_buffer(ctx, frame_buffer);
+    return true;
+}
+
+static void draw_indicator(Layer *layer, GContext* ctx) {
+    CompassCalibrationWindowData *data = *(CompassCalibrationWindowDataPtr*)layer_get_data(layer);
+
+    const GRect rect = layer_get_bounds(layer);
+    // computed in window_load() already, unless someone changed the bounds since
+    if (!grect_equal(&rect, &data->ring_bounds)) {
+        update_ring_geometry(data, rect);
+        data->ring_cache_valid = false;
+    }
+
+    graphics_context_set_stroke_color(ctx, GColorWhite);
+    graphics_context_set_fill_color(ctx, PBL_IF_COLOR_ELSE(GColorRed, GColorWhite));
+
+    // the finished ring is kept in ring_cache, only segments that changed since need to be drawn
+    if (data->ring_cache && data->ring_cache_valid && copy_ring_cache(ctx, layer, data->ring_cache, false)) {
+        if (has_damaged_segments(data)) {
+            draw_damaged_segments(data, ctx, rect);
+            copy_ring_cache(ctx, layer, data->ring_cache, true);
+        }
+    } else {
+        draw_ring(data, ctx, rect);
+        if (data->ring_cache) {
+            data->ring_cache_valid = copy_ring_cache(ctx, layer, data->ring_cache, true);
+        }
+    }
+
+    // draw current angle
+    graphics_fill_circle(ctx, point_at_angle(data->ring_center, data->current_angle, (int16_t) (data->ring_inner_radius - 6)), 4);
 }
 
 static TextLayer * create_and_add_text_layer(Layer *window_layer, GRect *all_text_rect, GAlign alignment, char *font_key, char *text) {
@@ -243,6 +436,7 @@ static TextLayer * create_and_add_text_layer(Layer *window_layer, GRect *all_tex
     grect_align(&label_rect, all_text_rect, alignment, true);
 
     TextLayer *layer = text_layer_create(label_rect);
+    if (!layer) return NULL;
     text_layer_set_text(layer, text);
     text_layer_set_background_color(layer, GColorClear);
     text_layer_set_text_color(layer, GColorWhite);
@@ -265,6 +459,7 @@ static void window_load(Window *window) {
     *(CompassCalibrationWindowDataPtr*)layer_get_data(data->indicator_layer) = data;
     layer_set_update_proc(data->indicator_layer, draw_indicator);
     layer_add_child(window_layer, data->indicator_layer);
+    update_ring_geometry(data, layer_get_bounds(data->indicator_layer));
 
     // TODO: get rid of absolute coordinates
     // note, as there's not way to detect bounds changes of a layer, one has to do this during update
@@ -273,15 +468,31 @@ static void window_load(Window *window) {
     grect_align(&all_text_rect, &frame, GAlignCenter, true);
     data->headline_layer = create_and_add_text_layer(window_layer, &all_text_rect, GAlignTop, FONT_KEY_GOTHIC_18_BOLD, INITIAL_HEADLINE);
     data->description_layer = create_and_add_text_layer(window_layer, &all_text_rect, GAlignBottom, FONT_KEY_GOTHIC_18, INITIAL_DESCRIPTION);
+    data->shown_progress = CalibrationProgressInitial;
     update_description_if_needed(data);
+
+    // optional and hence allocated last: the rows of the indicator layer at the frame buffer's width and bits per pixel,
+    // draw_indicator() draws everything each time without it
+    data->ring_cache = gbitmap_create_blank(GSize(layer_get_bounds(window_layer).size.w, frame.size.h), PBL_IF_COLOR_ELSE(GBitmapFormat8Bit, GBitmapFormat1Bit));
+    data->ring_cache_valid = false;
 }
 
 static void window_unload(Window *window) {
     CompassCalibrationWindowData *data = window_get_user_data(window);
+    if (data->ring_cache) {
+        gbitmap_destroy(data->ring_cache);
+    }
     layer_destroy(data->indicator_layer);
-    text_layer_destroy(data->headline_layer);
-    text_layer_destroy(data->description_layer);
+    if (data->headline_layer) {
+        text_layer_destroy(data->headline_layer);
+    }
+    if (data->description_layer) {
+        text_layer_destroy(data->description_layer);
+    }
+    const uint8_t num_segments = data->num_segments;
     memset(data, 0, sizeof(CompassCalibrationWindowData));
+    data->num_segments = num_segments;
+    reset_segment_data(data, false);
 }
 
 static void pop_all_click_handler(ClickRecognizerRef recognizer, void *context) {
@@ -307,6 +518,7 @@ CompassCalibrationWindow *compass_calibration_window_create() {
     CompassCalibrationWindowData *data = malloc(sizeof(CompassCalibrationWindowData));
     memset(data, 0, sizeof(CompassCalibrationWindowData));
 
+    data->num_segments = CALIBRATION_MAX_SEGMENTS;
     reset_segment_data(data, true);
 
     window_set_user_data(window, data);
@@ -330,129 +542,172 @@ void compass_calibration_window_destroy(CompassCalibrationWindow *window) {
 
 
 // -----
-// TODO: remove this duplication once PBL-5833 has been fixed
-// also, see https://github.com/pebble/tintin/pull/2261
+// scanline rasterizer for the ring segments, replaces a copy of the firmware's gpath_draw_filled()
+// edges go into an edge table, bucketed by their top row, and become active when the scanline reaches them
+// active edges step their x incrementally, spans between them are filled following the non-zero winding rule
 
-static void swap16(int16_t *a, int16_t *b) {
-    int16_t tmp = *a;
-    *a = *b;
-    *b = tmp;
+#define QUAD_FILL_MAX_EDGES (CALIBRATION_MAX_QUADS_PER_FILL * 4)
+#define QUAD_FILL_MAX_ROWS PBL_IF_ROUND_ELSE(180, 168)
+#define QUAD_FILL_NO_EDGE UINT8_MAX
+
+// x advances by a fraction per row, kept as whole pixels plus remainder / denominator to round exactly like
+// gpath_draw_filled() which interpolates from the first point of an edge and rounds halves away from zero
+typedef struct {
+    int16_t x;           // at the current row
+    int16_t whole_step;  // per row
+    int16_t remainder;   // 0 <= remainder < denominator
+    int16_t fraction;    // added to (or subtracted from) remainder per row
+    int16_t denominator;
+    int8_t sign;         // direction x moves away from the first point of the edge
+    bool towards_start;  // true if rows approach the first point of the edge, i.e. the edge goes up
+    int16_t y_bottom;    // last row of the edge, inclusive
+    int8_t winding;      // +1 or -1, normalized so that all quads wind the same way
+    uint8_t next;        // next edge in the same bucket of the edge table
+} QuadFillEdge;
+
+// no need for the heap, the rasterizer isn't reentrant anyway
+static struct {
+    QuadFillEdge edges[QUAD_FILL_MAX_EDGES];
+    uint8_t edge_table[QUAD_FILL_MAX_ROWS];
+    uint8_t active[QUAD_FILL_MAX_EDGES];
+} s_quad_fill;
+
+static int direction(GPoint from, GPoint to) {
+    return to.y > from.y ? 1 : (to.y < from.y ? -1 : 0);
 }
 
-static void sort16(int16_t *values, size_t length) {
-    for (unsigned int i = 0; i < length; i++) {
-        for (unsigned int j = i+1; j < length; j++) {
-            if (values[i] > values[j]) {
-                swap16(&values[i], &values[j]);
-            }
+// moves edge to the next row
+static void step_edge(QuadFillEdge *edge) {
+    if (edge->towards_start) {
+        edge->x = (int16_t) (edge->x - edge->whole_step);
+        edge->remainder = (int16_t) (edge->remainder - edge->fraction);
+        if (edge->remainder < 0) {
+            edge->remainder = (int16_t) (edge->remainder + edge->denominator);
+            edge->x = (int16_t) (edge->x - edge->sign);
+        }
+    } else {
+        edge->x = (int16_t) (edge->x + edge->whole_step);
+        edge->remainder = (int16_t) (edge->remainder + edge->fraction);
+        if (edge->remainder >= edge->denominator) {
+            edge->remainder = (int16_t) (edge->remainder - edge->denominator);
+            edge->x = (int16_t) (edge->x + edge->sign);
         }
     }
 }
 
-static int integer_divide_round_closest(const int n, const int d) {
-    return ((n < 0) ^ (d < 0)) ? ((n - d/2)/d) : ((n + d/2)/d);
-}
-
-static void _gpath_draw_filled(GContext* ctx, GPath* path) {
-    if (path->num_points < 2) {
+static void fill_quads(GContext *ctx, const CompassCalibrationWindowQuad *quads, int num_quads, GRect clip) {
+    const int16_t clip_top = MAX(clip.origin.y, 0);
+    const int16_t clip_bottom = (int16_t) MIN(clip.origin.y + clip.size.h, QUAD_FILL_MAX_ROWS) - 1;
+    if (num_quads <= 0 || clip_bottom < clip_top) {
         return;
     }
-
-    GPoint* rot_points = path->points;
-    int min_x, max_x, min_y, max_y;
-    GPoint rot_start, rot_end;
-    bool found_start_direction = false;
-    bool start_is_down = false;
-
-    rot_points[0] = rot_end = path->points[0];
-    min_x = max_x = rot_points[0].x;
-    min_y = max_y = rot_points[0].y;
-
-    // begin finding the last path segment's direction going backwards through the path
-    // we must go backwards because we find intersections going forwards
-    for (int i = path->num_points - 1; i > 0; --i) {
-        rot_start = path->points[i];
-        if (min_x > rot_points[i].x) { min_x = rot_points[i].x; }
-        if (max_x < rot_points[i].x) { max_x = rot_points[i].x; }
-        if (min_y > rot_points[i].y) { min_y = rot_points[i].y; }
-        if (max_y < rot_points[i].y) { max_y = rot_points[i].y; }
-
-        if (found_start_direction) {
-            continue;
+    memset(s_quad_fill.edge_table, QUAD_FILL_NO_EDGE, sizeof(s_quad_fill.edge_table));
+
+    // build the edge table
+    int num_edges = 0;
+    int16_t first_row = clip_bottom + 1;
+    int16_t last_row = clip_top - 1;
+    for (int q = 0; q < MIN(num_quads, CALIBRATION_MAX_QUADS_PER_FILL); q++) {
+        const GPoint *p = quads[q].points;
+
+        // counter-clockwise quads would cancel out clockwise ones where they overlap
+        int32_t area = 0;
+        for (int i = 0; i < 4; i++) {
+            area += p[i].x * p[(i + 1) % 4].y - p[(i + 1) % 4].x * p[i].y;
         }
+        const int8_t orientation = (int8_t) (area < 0 ? -1 : 1);
+
+        for (int i = 0; i < 4; i++) {
+            const GPoint from = p[i];
+            const GPoint to = p[(i + 1) % 4];
+            const int dir = direction(from, to);
+            if (dir == 0) {
+                // horizontal edges are covered by the spans of their neighbors
+                continue;
+            }
 
-        // use the first non-horizontal path segment's direction as the start direction
-        if (rot_end.y != rot_start.y) {
-            start_is_down = rot_end.y > rot_start.y;
-            found_start_direction = true;
-        }
+            // like gpath_draw_filled(), rows are inclusive at both ends
+            // but if the previous edge continues in the same direction, they share the row of the vertex
+            int prev_dir = 0;
+            for (int k = 3; k > 0 && prev_dir == 0; k--) {
+                prev_dir = direction(p[(i + k) % 4], p[(i + k + 1) % 4]);
+            }
 
-        rot_end = rot_start;
-    }
+            const GPoint top = dir > 0 ? from : to;
+            const GPoint bottom = dir > 0 ? to : from;
+            int16_t y_top = top.y;
+            int16_t y_bottom = bottom.y;
+            if (prev_dir == dir) {
+                if (dir > 0) y_top++; else y_bottom--;
+            }
 
-    // x-intersections of path segments whose direction is up
-    int16_t* intersections_up = malloc(path->num_points * sizeof(int16_t));
-    // x-intersections of path segments whose direction is down
-    int16_t* intersections_down = malloc(path->num_points * sizeof(int16_t));
-    size_t intersection_up_count;
-    size_t intersection_down_count;
-
-    // find all of the horizontal intersections and draw them
-    min_y = MAX(min_y, 0);
-    max_y = MIN(max_y, 167);
-    for (int i = min_y; i <= max_y; ++i) {
-        // initialize with 0 intersections
-        intersection_down_count = 0;
-        intersection_up_count = 0;
-
-        // horizontal path segments don't have a direction and depend upon the last path segment's direction
-        // keep track of the last path direction for horizontal path segments to use
-        bool last_is_down = start_is_down;
-        rot_end = rot_points[0];
-
-        // find the intersections
-        for (unsigned int j = 0; j < path->num_points; ++j) {
-            rot_start = rot_points[j];
-            if (j + 1 < path->num_points) {
-                rot_end = rot_points[j + 1];
-            } else {
-                // wrap to the first point
-                rot_end = rot_points[0];
+            y_top = MAX(y_top, clip_top);
+            if (y_top > y_bottom || y_top > clip_bottom) {
+                continue;
             }
 
-            // if the line is on/crosses this height
-            if ((rot_start.y - i) * (rot_end.y - i) <= 0) {
-                bool is_down = rot_end.y != rot_start.y ? rot_end.y > rot_start.y : last_is_down;
-                // don't count end points in the same direction to avoid double intersections
-                if (!(rot_start.y == i && last_is_down == is_down)) {
-                    // linear interpolation of the line intersection
-                    int16_t x = (int16_t)(rot_start.x + integer_divide_round_closest((rot_end.x - rot_start.x) * (i - rot_start.y), (rot_end.y - rot_start.y)));
-                    if (is_down) {
-                        intersections_down[intersection_down_count] = x;
-                        intersection_down_count++;
-                    } else {
-                        intersections_up[intersection_up_count] = x;
-                        intersection_up_count++;
-                    }
-                }
-                last_is_down = is_down;
+            // x = from.x + sign * round(|to.x - from.x| * |y - from.y| / |to.y - from.y|), evaluated once for y_top
+            QuadFillEdge *edge = &s_quad_fill.edges[num_edges];
+            const int16_t dx = (int16_t) abs(to.x - from.x);
+            edge->denominator = (int16_t) abs(to.y - from.y);
+            edge->sign = (int8_t) (to.x < from.x ? -1 : 1);
+            edge->towards_start = dir < 0;
+            edge->whole_step = (int16_t) (edge->sign * (dx / edge->denominator));
+            edge->fraction = (int16_t) (dx % edge->denominator);
+            const int32_t numerator = dx * abs(y_top - from.y) + edge->denominator / 2;
+            edge->x = (int16_t) (from.x + edge->sign * (numerator / edge->denominator));
+            edge->remainder = (int16_t) (numerator % edge->denominator);
+            edge->y_bottom = y_bottom;
+            edge->winding = (int8_t) (dir * orientation);
+
+            edge->next = s_quad_fill.edge_table[y_top - clip_top];
+            s_quad_fill.edge_table[y_top - clip_top] = (uint8_t) num_edges;
+            num_edges++;
+            first_row = MIN(first_row, y_top);
+            last_row = MAX(last_row, MIN(y_bottom, clip_bottom));
+        }
+    }
+
+    // walk the scanlines
+    int num_active = 0;
+    for (int16_t y = first_row; y <= last_row; y++) {
+        for (uint8_t e = s_quad_fill.edge_table[y - clip_top]; e != QUAD_FILL_NO_EDGE; e = s_quad_fill.edges[e].next) {
+            s_quad_fill.active[num_active++] = e;
+        }
+
+        // keep the active edges sorted by x, they barely change their order from row to row
+        for (int i = 1; i < num_active; i++) {
+            const uint8_t e = s_quad_fill.active[i];
+            int j = i;
+            for (; j > 0 && s_quad_fill.edges[s_quad_fill.active[j - 1]].x > s_quad_fill.edges[e].x; j--) {
+                s_quad_fill.active[j] = s_quad_fill.active[j - 1];
             }
+            s_quad_fill.active[j] = e;
         }
 
-        // sort the intersections
-        sort16(intersections_up, intersection_up_count);
-        sort16(intersections_down, intersection_down_count);
+        int winding = 0;
+        int16_t span_start = 0;
+        for (int i = 0; i < num_active; i++) {
+            const QuadFillEdge *edge = &s_quad_fill.edges[s_quad_fill.active[i]];
+            const int16_t x = edge->x;
+            if (winding == 0) {
+                span_start = x;
+            }
+            winding += edge->winding;
+            if (winding == 0) {
+                graphics_fill_rect(ctx, GRect(span_start, y, (int16_t) (x - span_start + 1), 1), 0, GCornerNone);
+            }
+        }
 
-        // draw the line segments
-        for (int j = 0; j < (int)MIN(intersection_up_count, intersection_down_count); j++) {
-            int16_t x_a = intersections_up[j];
-            int16_t x_b = intersections_down[j];
-            if (x_a > x_b) {
-                swap16(&x_a, &x_b);
+        // retire edges that end on this row, advance the others
+        int remaining = 0;
+        for (int i = 0; i < num_active; i++) {
+            QuadFillEdge *edge = &s_quad_fill.edges[s_quad_fill.active[i]];
+            if (edge->y_bottom > y) {
+                step_edge(edge);
+                s_quad_fill.active[remaining++] = s_quad_fill.active[i];
             }
-            graphics_fill_rect(ctx, GRect(x_a, (int16_t)i, (int16_t)(x_b - x_a + 1), 1), 0, GCornerNone);
         }
+        num_active = remaining;
     }
-    free(intersections_up);
-    free(intersections_down);
 }
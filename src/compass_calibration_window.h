@@ -1,3 +1,5 @@
+#pragma once
+
 #include "pebble.h"
 
 typedef struct CompassCalibrationWindow CompassCalibrationWindow;
@@ -17,6 +19,12 @@ void compass_calibration_window_merge_value(CompassCalibrationWindow *window, in
 //! manually set the indicated angle, not needed if you use compass_calibration_window_apply_accel_data()
 void compass_calibration_window_set_current_angle(CompassCalibrationWindow *window, int32_t angle);
 
+//! sets the number of segments of the ring, fewer segments are cheaper to track and to draw
+//! values are clamped to 8...80, the default is 80
+//! changing the number of segments discards the values merged so far
+void compass_calibration_window_set_num_segments(CompassCalibrationWindow *window, uint8_t num_segments);
+uint8_t compass_calibration_window_get_num_segments(CompassCalibrationWindow *window);
+
 //! Use this function to inform user about (electro-)magnetic interferences
 void compass_calibration_window_set_influenced_by_magnetic_interference(CompassCalibrationWindow *window, bool influenced);
 
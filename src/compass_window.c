@@ -41,12 +41,30 @@ typedef struct {
     // will be created on demand
     bool window_appeared;
     CompassCalibrationWindow *calibration_window;
+
+    // what compass_layer_update_layout() presented last, changes that move nothing by a whole pixel are skipped
+    // changes that arrive while the calibration window is shown wait in pending_changes
+    bool layout_valid;
+    DataProviderChanges pending_changes;
+    int32_t layout_degrees;
+    AccelData layout_accel;
+    CompassWindowLayoutStats layout_stats;
 } CompassWindowData;
 
 Window *compass_window_get_window(CompassWindow *window) {
     return (Window *)window;
 }
 
+DataProvider *compass_window_get_data_provider(CompassWindow *window) {
+    CompassWindowData *data = window_get_user_data((Window *)window);
+    return data->data_provider;
+}
+
+CompassWindowLayoutStats compass_window_get_layout_stats(CompassWindow *window) {
+    CompassWindowData *data = window_get_user_data((Window *)window);
+    return data->layout_stats;
+}
+
 static GSize size_blend(GSize s1, GSize s2, float f) {
     return (GSize){
         (int16_t) (s1.w * (1-f) + f * s2.w),
@@ -82,60 +100,63 @@ static void small_cross_hair_layer_update(Layer *layer, GContext *ctx) {
   GBitmapFormat bg_format = gbitmap_get_format(bg_image);
 
   GRect fg_frame = layer_get_frame(layer);
+  uint32_t mask[fg_frame.size.w / 32 + 1];
 
+  // white pixels of the cross hair turn red on color displays and invert the background otherwise
   for(int16_t y = 0; y < fg_frame.size.h; y++) {
-    for(int16_t x = 0; x < fg_frame.size.w; x++) {
-
-      GColor bg_pixel = get_bitmap_pixel_color(bg_image, bg_format, fg_frame.origin.y + y, fg_frame.origin.x + x);
-      GColor fg_pixel = get_bitmap_pixel_color(data->small_cross_hair, data->small_cross_hair_format, y, x);
-
-      if(gcolor_equal(bg_pixel, GColorWhite) && gcolor_equal(fg_pixel, GColorWhite)) {
-        set_bitmap_pixel_color(bg_image, bg_format, fg_frame.origin.y + y, fg_frame.origin.x + x, PBL_IF_COLOR_ELSE(GColorRed, GColorBlack));
-      }
-      else if(gcolor_equal(fg_pixel, GColorWhite)) {
-        set_bitmap_pixel_color(bg_image, bg_format, fg_frame.origin.y + y, fg_frame.origin.x + x, PBL_IF_COLOR_ELSE(GColorRed, GColorWhite));
-      }
-
-    }
+    bitmap_get_span_mask(data->small_cross_hair, data->small_cross_hair_format, y, 0, fg_frame.size.w, GColorWhite, mask);
+#if defined(PBL_COLOR)
+    bitmap_mask_blit_span(bg_image, bg_format, fg_frame.origin.y + y, fg_frame.origin.x, fg_frame.size.w, mask, GColorRed);
+#else
+    bitmap_invert_span(bg_image, bg_format, fg_frame.origin.y + y, fg_frame.origin.x, fg_frame.size.w, mask);
+#endif
   }
 
   graphics_release_frame_buffer(ctx, bg_image);
 }
 
-static void compass_layer_update_layout(CompassWindowData *data) {
+// the needle: angle of the ticks and the texts
+static bool compass_layer_update_heading(CompassWindowData *data, bool force) {
     int32_t angle = data_provider_get_presentation_angle(data->data_provider);
-    ticks_layer_set_angle(data->ticks_layer, angle);
+    int32_t normalized_angle = ((int)(angle * 360 / TRIG_MAX_ANGLE) % 360 + 360) % 360;
+    const float transition_factor = ticks_layer_get_transition_factor(data->ticks_layer);
+    if (!force && normalized_angle == data->layout_degrees &&
+            ticks_layer_get_displacement(data->ticks_layer, angle, transition_factor) == 0) {
+        return false;
+    }
+    data->layout_degrees = normalized_angle;
 
-    const float transition_factor = data_provider_get_orientation_transition_factor(data->data_provider);
-    ticks_layer_set_transition_factor(data->ticks_layer, transition_factor);
+    ticks_layer_set_angle(data->ticks_layer, angle);
 
     static char angle_text[] = "123°";
-    int32_t normalized_angle = ((int)(angle * 360 / TRIG_MAX_ANGLE) % 360 + 360) % 360;
     snprintf(angle_text, sizeof(angle_text), "%d°", (int)normalized_angle);
     text_layer_set_text(data->angle_layer, angle_text);
-    GRect r = rect_blend(&data->angle_layer_rect_rose, &data->angle_layer_rect_band, transition_factor);
-    layer_set_frame(text_layer_get_layer(data->angle_layer), r);
-    // workaround for PBL-8492, manually call set_bounds after changing the frame
-    layer_set_bounds(text_layer_get_layer(data->angle_layer), (GRect){.size=r.size});
 
     static char *direction_texts[] = {"N", "NE", "E", "SE", "S", "SW", "W", "NW"};
     const int degrees_per_text = 360 / ARRAY_LENGTH(direction_texts);
     int32_t direction_index = ((normalized_angle + (degrees_per_text / 2)) / degrees_per_text) % ARRAY_LENGTH(direction_texts);
     text_layer_set_text(data->direction_layer, direction_texts[direction_index]);
-    layer_set_frame(text_layer_get_layer(data->direction_layer), rect_blend(&data->direction_layer_rect_rose, &data->direction_layer_rect_band, transition_factor));
+    return true;
+}
 
-    layer_set_frame(data->pointer_layer, rect_blend(&data->pointer_layer_rect_rose, &data->pointer_layer_rect_band, transition_factor));
+// the level: small cross hair
+static bool compass_layer_update_level(CompassWindowData *data, bool force) {
+    int16_t d = 40;   // TODO: get rid of magic number
 
-    GRect frame = layer_get_frame(ticks_layer_get_layer(data->ticks_layer));
+    // the small cross hair moves by a pixel per d, it stays where it is until the accelerometer moved by more than half of that
+    AccelData ad = data_provider_last_accel_data(data->data_provider);
+    if (abs(ad.x - data->layout_accel.x) < d / 2 && abs(ad.y - data->layout_accel.y) < d / 2) {
+        if (!force) {
+            return false;
+        }
+        ad = data->layout_accel;
+    }
+    data->layout_accel = ad;
 
-    // make crosses move down outside the screen when transition to cartesian representation
+    const float transition_factor = ticks_layer_get_transition_factor(data->ticks_layer);
+    GRect frame = layer_get_frame(ticks_layer_get_layer(data->ticks_layer));
     int16_t transition_dy = (int16_t) (transition_factor * frame.size.h);
 
-    layer_set_frame(bitmap_layer_get_layer(data->large_cross_hair_layer),
-            rect_centered_with_size_and_offset(&frame, gbitmap_get_bounds(data->large_cross_hair).size, GPoint(1, transition_dy)));
-
-    int16_t d = 40;   // TODO: get rid of magic number
-    AccelData ad = data_provider_last_accel_data(data->data_provider);
     GPoint small_cross_hair_offset = GPoint((int16_t)(1 - ad.x / d), ad.y / d);
     // make small cross hair stick to center during transition until almost back to polar representation
     float tf2 = (1-transition_factor) * (1-transition_factor);
@@ -146,7 +167,66 @@ static void compass_layer_update_layout(CompassWindowData *data) {
 
     layer_set_frame(data->small_cross_hair_layer,
             rect_centered_with_size_and_offset(&frame, GSize(17, 17), small_cross_hair_offset));
+    return true;
+}
+
+// the orientation: blends the frames of everything between rose and band
+static bool compass_layer_update_transition(CompassWindowData *data, bool force) {
+    const float transition_factor = data_provider_get_orientation_transition_factor(data->data_provider);
+    if (!force && ticks_layer_get_displacement(data->ticks_layer, ticks_layer_get_angle(data->ticks_layer), transition_factor) == 0) {
+        return false;
+    }
+
+    ticks_layer_set_transition_factor(data->ticks_layer, transition_factor);
+
+    GRect r = rect_blend(&data->angle_layer_rect_rose, &data->angle_layer_rect_band, transition_factor);
+    layer_set_frame(text_layer_get_layer(data->angle_layer), r);
+    // workaround for PBL-8492, manually call set_bounds after changing the frame
+    layer_set_bounds(text_layer_get_layer(data->angle_layer), (GRect){.size=r.size});
+    layer_set_frame(text_layer_get_layer(data->direction_layer), rect_blend(&data->direction_layer_rect_rose, &data->direction_layer_rect_band, transition_factor));
+
+    layer_set_frame(data->pointer_layer, rect_blend(&data->pointer_layer_rect_rose, &data->pointer_layer_rect_band, transition_factor));
+
+    GRect frame = layer_get_frame(ticks_layer_get_layer(data->ticks_layer));
+
+    // make crosses move down outside the screen when transition to cartesian representation
+    int16_t transition_dy = (int16_t) (transition_factor * frame.size.h);
+
+    layer_set_frame(bitmap_layer_get_layer(data->large_cross_hair_layer),
+            rect_centered_with_size_and_offset(&frame, gbitmap_get_bounds(data->large_cross_hair).size, GPoint(1, transition_dy)));
 
+    // the small cross hair follows the frame of the ticks
+    compass_layer_update_level(data, true);
+    return true;
+}
+
+// only touches the layers that depend on what changed, skips changes that move nothing by a whole pixel
+static void compass_layer_update_layout(CompassWindowData *data, DataProviderChanges changes) {
+    const bool force = !data->layout_valid;
+    if (force) {
+        changes = DataProviderChangeAll;
+    }
+    data->layout_valid = true;
+
+    bool updated = false;
+    if (changes & DataProviderChangeTransition) {
+        const bool transition_updated = compass_layer_update_transition(data, force);
+        data->layout_stats.num_transition_updates += transition_updated;
+        updated = updated || transition_updated;
+    }
+    if (changes & DataProviderChangeHeading) {
+        const bool heading_updated = compass_layer_update_heading(data, force);
+        data->layout_stats.num_heading_updates += heading_updated;
+        updated = updated || heading_updated;
+    }
+    if (changes & DataProviderChangeLevel) {
+        const bool level_updated = compass_layer_update_level(data, force);
+        data->layout_stats.num_level_updates += level_updated;
+        updated = updated || level_updated;
+    }
+
+    data->layout_stats.num_updates++;
+    data->layout_stats.num_suppressed += !updated;
 }
 
 static void pointer_layer_update(Layer *layer, GContext *ctx) {
@@ -159,18 +239,13 @@ static void pointer_layer_update(Layer *layer, GContext *ctx) {
 
   GRect fg_frame = layer_get_frame(layer);
 
+  // black turns red on color displays, everything else white, the pointer inverts the background otherwise
   for(int16_t y = 0; y < fg_frame.size.h; y++) {
-    for(int16_t x = 0; x < fg_frame.size.w; x++) {
-
-      GColor bg_pixel = get_bitmap_pixel_color(bg_image, bg_format, fg_frame.origin.y + y, fg_frame.origin.x + x);
-
-      if(!gcolor_equal(bg_pixel, GColorBlack)) {
-        set_bitmap_pixel_color(bg_image, bg_format, fg_frame.origin.y + y, fg_frame.origin.x + x, PBL_IF_COLOR_ELSE(GColorWhite, GColorBlack));
-      }
-      else {
-        set_bitmap_pixel_color(bg_image, bg_format, fg_frame.origin.y + y, fg_frame.origin.x + x, PBL_IF_COLOR_ELSE(GColorRed, GColorWhite));
-      }
-    }
+#if defined(PBL_COLOR)
+    bitmap_recolor_span(bg_image, bg_format, fg_frame.origin.y + y, fg_frame.origin.x, fg_frame.size.w, NULL, GColorBlack, GColorRed, GColorWhite);
+#else
+    bitmap_invert_span(bg_image, bg_format, fg_frame.origin.y + y, fg_frame.origin.x, fg_frame.size.w, NULL);
+#endif
   }
 
   graphics_release_frame_buffer(ctx, bg_image);
@@ -245,6 +320,10 @@ static void compass_window_appear(Window *window) {
     // needed to prevent calibration window appearing before the compass was presented
     CompassWindowData *data = window_get_user_data(window);
     data->window_appeared = true;
+
+    // catch up with what changed while the calibration window was shown
+    compass_layer_update_layout(data, data->pending_changes);
+    data->pending_changes = DataProviderChangeNone;
 }
 
 static void compass_window_unload(Window *window) {
@@ -268,11 +347,15 @@ void propagate_interference_to_calibration_window(CompassWindowData *window_data
     }
 }
 
+static bool calibration_window_is_shown(CompassWindowData *data) {
+    return data->calibration_window && window_stack_get_top_window() == compass_calibration_window_get_window(data->calibration_window);
+}
+
 static void handle_data_provider_update(DataProvider *provider, void *user_data) {
     // switch between calibration window and actual compass
 
     CompassWindowData *data = user_data;
-    if (data->calibration_window && window_stack_get_top_window() == compass_calibration_window_get_window(data->calibration_window)) {
+    if (calibration_window_is_shown(data)) {
         AccelData accel_data = data_provider_get_damped_accel_data(provider);
         compass_calibration_window_apply_accel_data(data->calibration_window, accel_data);
 
@@ -281,8 +364,6 @@ static void handle_data_provider_update(DataProvider *provider, void *user_data)
             vibes_long_pulse();
         }
     } else {
-        compass_layer_update_layout(data);
-
         if (data->window_appeared && data_provider_compass_needs_calibration(provider)) {
             if (!data->calibration_window) {
                 data->calibration_window = compass_calibration_window_create();
@@ -293,6 +374,16 @@ static void handle_data_provider_update(DataProvider *provider, void *user_data)
     }
 }
 
+// once per frame at most, see DataProviderHandlers.presentation_changed
+static void handle_data_provider_presentation_changed(DataProvider *provider, void *user_data) {
+    CompassWindowData *data = user_data;
+    data->pending_changes |= data_provider_get_changes(provider);
+    if (calibration_window_is_shown(data)) return;
+
+    compass_layer_update_layout(data, data->pending_changes);
+    data->pending_changes = DataProviderChangeNone;
+}
+
 static void handle_data_provider_interference_update(DataProvider *provider, void* user_data) {
     CompassWindowData *data = user_data;
     propagate_interference_to_calibration_window(data);
@@ -301,10 +392,12 @@ static void handle_data_provider_interference_update(DataProvider *provider, voi
 CompassWindow *compass_window_create() {
     Window *window = window_create();
     CompassWindowData *data = malloc(sizeof(CompassWindowData));
+    memset(data, 0, sizeof(CompassWindowData));
 
     data->data_provider = data_provider_create(data, (DataProviderHandlers) {
             .presented_angle_or_accel_data_changed = handle_data_provider_update,
             .orientation_transition_factor_changed = handle_data_provider_update,
+            .presentation_changed = handle_data_provider_presentation_changed,
             .magnetic_interference_changed = handle_data_provider_interference_update,
     });
 
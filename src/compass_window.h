@@ -1,8 +1,25 @@
+#pragma once
+
 #include "pebble.h"
+#include "data_provider.h"
 
 typedef struct CompassWindow CompassWindow;
 
 Window *compass_window_get_window(CompassWindow *window);
+DataProvider *compass_window_get_data_provider(CompassWindow *window);
+
+typedef struct {
+    // layout passes requested by the data provider
+    uint32_t num_updates;
+    // of these, the ones skipped because neither the rose, the needle, the texts nor the cross hairs would move by a pixel
+    uint32_t num_suppressed;
+    // layouts of the parts that changed, a pass can update several of them
+    uint32_t num_heading_updates;
+    uint32_t num_level_updates;
+    uint32_t num_transition_updates;
+} CompassWindowLayoutStats;
+
+CompassWindowLayoutStats compass_window_get_layout_stats(CompassWindow *window);
 
 CompassWindow *compass_window_create();
 void compass_window_destroy(CompassWindow *window);
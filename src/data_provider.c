@@ -1,14 +1,15 @@
 #include "pebble.h"
 #include "data_provider.h"
 
-typedef struct {
+typedef struct DataProviderState {
     int32_t target_angle;
     int32_t angular_velocity;
     int32_t presentation_angle;
     int32_t compass_delta_angle;
-    float friction;
-    float attraction;
+    DataProviderFixed friction;
+    DataProviderFixed attraction;
     AppTimer *timer;
+    bool animating;
     DataProviderHandlers handlers;
     void *user_data;
 
@@ -17,22 +18,130 @@ typedef struct {
     float orientation_animation_start_value;
     Animation *orientation_animation;
 
+    uint32_t accel_samples_per_update;
+    // index into DATA_PROVIDER_ACCEL_RATES, see update_accel_rate()
+    uint8_t accel_rate_level;
+    int32_t accel_motion_energy;
+    uint32_t accel_quiet_ms;
+    DataProviderAccelRateStats accel_rate_stats;
+    bool accel_data_received;
     AccelData last_accel_data;
     AccelData damped_accel_data;
+    // last_accel_data at the time the update loop parked, see data_provider_handle_accel_data()
+    AccelData parked_accel_data;
 
     CompassHeadingData heading;
+    // see fuse_heading()
+    bool heading_received;
+    int32_t measured_heading;
+    int32_t fused_heading;
+    AccelData fusion_gravity;
+    // see update_heading_filter()
+    uint8_t heading_filter_mode;
+    uint64_t heading_filter_mode_start_ms;
+    DataProviderHeadingFilterStats heading_filter_stats;
 
     BatteryChargeState battery_charge_state;
+
+    // records the sensor callbacks if set, see data_provider_set_sensor_trace()
+    SensorTrace *sensor_trace;
+
+    // what the handlers were told last, see report_changes()
+    bool reported;
+    int32_t reported_angle;
+    AccelData reported_accel_data;
+    float reported_transition_factor;
+    DataProviderChanges changes;
+
+    // presentation_changed runs once per frame period with the changes collected meanwhile, see queue_frame()
+    AppTimer *frame_timer;
+    uint64_t frame_ms;
+    DataProviderChanges frame_changes;
+    DataProviderFrameStats frame_stats;
+
+    // next provider the service callbacks are dispatched to, see dispatch_accel_data()
+    struct DataProviderState *next_provider;
 } DataProviderState;
 
-// TODO: get rid of floats throughout this file (see readme)
+// TODO: get rid of floats throughout this file (see readme), the spring physics are fixed point already
 
 static const int DATA_PROVIDER_FPS = 22;
 
-// TODO: get rid of this singleton. Unfortunately, compass API does not support a context object
-DataProviderState* dataProviderStateSingleton;
+// the update loop parks once both the remaining distance and the velocity are below this angle
+// 1/1024 of a turn is less than half a pixel on the rim of the rose on all platforms
+static const int32_t DATA_PROVIDER_SETTLE_THRESHOLD = TRIG_MAX_ANGLE / 1024;
+
+// a parked update loop resumes if the accelerometer moved by more than this (in mG) on any axis
+// the level indicator moves one pixel per 40mG
+static const int16_t DATA_PROVIDER_ACCEL_WAKE_THRESHOLD = 20;
+
+// the accelerometer runs at 10Hz while the watch lies still and at 50Hz or 100Hz while it moves
+typedef enum {
+    DataProviderAccelRateLevelStill,
+    DataProviderAccelRateLevelNormal,
+    DataProviderAccelRateLevelFast,
+} DataProviderAccelRateLevel;
+
+static const AccelSamplingRate DATA_PROVIDER_ACCEL_RATES[] = {
+    [DataProviderAccelRateLevelStill] = ACCEL_SAMPLING_10HZ,
+    [DataProviderAccelRateLevelNormal] = ACCEL_SAMPLING_50HZ,
+    [DataProviderAccelRateLevelFast] = ACCEL_SAMPLING_100HZ,
+};
+
+// first order IIR filters applied to each accelerometer sample, weight of the new sample
+// 0.99 and 0.3 at 50Hz, the other rates use 1 - (1 - w)^(50 / rate) to keep the response time the same
+static const DataProviderFixed DATA_PROVIDER_LAST_ACCEL_WEIGHT[] = {
+    [DataProviderAccelRateLevelStill] = DATA_PROVIDER_FIXED_ONE,
+    [DataProviderAccelRateLevelNormal] = DATA_PROVIDER_FIXED_FROM_FLOAT(0.99f),
+    [DataProviderAccelRateLevelFast] = DATA_PROVIDER_FIXED_FROM_FLOAT(0.9f),
+};
+static const DataProviderFixed DATA_PROVIDER_DAMPED_ACCEL_WEIGHT[] = {
+    [DataProviderAccelRateLevelStill] = DATA_PROVIDER_FIXED_FROM_FLOAT(0.83193f),
+    [DataProviderAccelRateLevelNormal] = DATA_PROVIDER_FIXED_FROM_FLOAT(0.3f),
+    [DataProviderAccelRateLevelFast] = DATA_PROVIDER_FIXED_FROM_FLOAT(0.16334f),
+};
+
+// motion energy is the filtered sum of the absolute differences (in mG) between each sample and damped_accel_data
+// a watch on a table stays below 10, wearing it on a still arm stays below 30
+static const int32_t DATA_PROVIDER_MOTION_STILL = 30;
+static const int32_t DATA_PROVIDER_MOTION_MOVING = 60;
+static const int32_t DATA_PROVIDER_MOTION_FAST_OFF = 150;
+static const int32_t DATA_PROVIDER_MOTION_FAST_ON = 300;
+// rates go up immediately, but only go down after the motion stayed below the threshold for this long
+static const uint32_t DATA_PROVIDER_STILL_HOLD_MS = 3000;
+static const uint32_t DATA_PROVIDER_FAST_HOLD_MS = 1000;
+
+// the compass service only reports heading changes larger than the heading filter
+// while the needle rests, the SDK's default of 1 degree keeps the degree readout on the firmware's heading
+// while the user turns, a fine filter keeps the needle smooth, still well below a pixel on the rim of the rose
+static const CompassHeading DATA_PROVIDER_HEADING_FILTERS[] = {
+    [DataProviderHeadingFilterCoarse] = TRIG_MAX_ANGLE / 360,
+    [DataProviderHeadingFilterFine] = TRIG_MAX_ANGLE / 512,
+};
+// the fine filter is used once the needle turns faster than this per frame (about 11 degrees per second)
+// and until the update loop parks again
+static const int32_t DATA_PROVIDER_FINE_HEADING_VELOCITY = TRIG_MAX_ANGLE / 720;
+
+// the heading is blended into fused_heading once per accelerometer callback with one of these weights
+// tilting the wrist or jolting the watch disturbs the magnetometer, its headings are trusted less meanwhile
+static const DataProviderFixed DATA_PROVIDER_FUSION_WEIGHT_STABLE = DATA_PROVIDER_FIXED_ONE / 2;
+static const DataProviderFixed DATA_PROVIDER_FUSION_WEIGHT_TILTING = DATA_PROVIDER_FIXED_ONE / 16;
+static const DataProviderFixed DATA_PROVIDER_FUSION_WEIGHT_SPIKE = DATA_PROVIDER_FIXED_ONE / 32;
+// the gravity vector counts as tilting if it moves by more than this (in mG, sum of all axes) per callback
+static const int32_t DATA_PROVIDER_FUSION_TILT_THRESHOLD = 50;
+// damped_accel_data outside of this range (in mG) isn't gravity alone
+static const int32_t DATA_PROVIDER_FUSION_MIN_GRAVITY = 800;
+static const int32_t DATA_PROVIDER_FUSION_MAX_GRAVITY = 1200;
+
+// samples per accelerometer callback at 50Hz unless data_provider_set_accel_samples_per_update() says otherwise
+// 5 samples at 50Hz wake the app 10 times a second, the other rates scale this to keep the latency
+#define DATA_PROVIDER_DEFAULT_ACCEL_SAMPLES_PER_UPDATE 5
+#define DATA_PROVIDER_MAX_ACCEL_SAMPLES_PER_UPDATE 25
 
 static void schedule_update(DataProviderState *state);
+static void queue_frame(DataProviderState *state, DataProviderChanges changes);
+static uint64_t now_ms(void);
+static void set_heading_filter_mode(DataProviderState *state, DataProviderHeadingFilterMode mode);
 
 static void call_handler_if_set(DataProviderState *state, DataProviderHandler handler) {
     if(handler) {
@@ -40,36 +149,154 @@ static void call_handler_if_set(DataProviderState *state, DataProviderHandler ha
     }
 }
 
-static void update_state(DataProviderState *state) {
-    state->presentation_angle = state->presentation_angle + state->angular_velocity;
-    int32_t distance = state->target_angle - state->presentation_angle;
-    while (distance < -TRIG_MAX_ANGLE / 2) distance += TRIG_MAX_ANGLE;
-    while (distance > +TRIG_MAX_ANGLE / 2) distance -= TRIG_MAX_ANGLE;
+// calls handler with data_provider_get_changes() telling what moved since the previous report
+static void report_changes(DataProviderState *state, DataProviderHandler handler) {
+    const AccelData *a = &state->last_accel_data;
+    const AccelData *r = &state->reported_accel_data;
+    DataProviderChanges changes = DataProviderChangeAll;
+    if (state->reported) {
+        changes = (state->presentation_angle != state->reported_angle ? DataProviderChangeHeading : 0) |
+                  (a->x != r->x || a->y != r->y || a->z != r->z ? DataProviderChangeLevel : 0) |
+                  (state->orientation_transition_factor != state->reported_transition_factor ? DataProviderChangeTransition : 0);
+    }
+    state->reported = true;
+    state->reported_angle = state->presentation_angle;
+    state->reported_accel_data = state->last_accel_data;
+    state->reported_transition_factor = state->orientation_transition_factor;
+
+    state->changes = (DataProviderChanges) changes;
+    call_handler_if_set(state, handler);
+    state->changes = DataProviderChangeNone;
+
+    queue_frame(state, (DataProviderChanges) changes);
+}
+
+// ---------------
+// frames
+//
+// the update loop and the orientation animation run at different rates, each would lay out the window on its own
+// presentation_changed combines them: a change a frame period or more after the last delivery is delivered right away,
+// everything that arrives earlier waits for the end of that period on a timer
+
+static void deliver_frame(DataProviderState *state, uint64_t now) {
+    state->frame_ms = now;
+    state->frame_stats.num_frames++;
+
+    state->changes = state->frame_changes;
+    state->frame_changes = DataProviderChangeNone;
+    call_handler_if_set(state, state->handlers.presentation_changed);
+    state->changes = DataProviderChangeNone;
+}
+
+static void handle_frame_timer(void *data) {
+    DataProviderState *state = data;
+    state->frame_timer = NULL;
+    deliver_frame(state, now_ms());
+}
 
-    float attraction_factor = state->attraction;
-    if (state->handlers.attraction_modifier) {
-        attraction_factor = state->handlers.attraction_modifier((DataProvider *) state, attraction_factor, state->user_data);
+static void queue_frame(DataProviderState *state, DataProviderChanges changes) {
+    if (!state->handlers.presentation_changed) return;
+    if (changes == DataProviderChangeNone) {
+        state->frame_stats.num_skipped++;
+        return;
     }
-    int32_t attraction = (int32_t) (distance * attraction_factor);
-    state->angular_velocity += attraction;
-    float friction = state->friction;
-    if (state->handlers.friction_modifier) {
-        friction = state->handlers.friction_modifier((DataProvider *) state, friction, state->user_data);
+
+    state->frame_changes |= changes;
+    if (state->frame_timer) {
+        state->frame_stats.num_coalesced++;
+        return;
+    }
+    const uint64_t now = now_ms();
+    const uint64_t due_ms = state->frame_ms + 1000 / DATA_PROVIDER_FPS;
+    if (now >= due_ms) {
+        deliver_frame(state, now);
+    } else {
+        state->frame_timer = app_timer_register((uint32_t) (due_ms - now), handle_frame_timer, state);
     }
-    state->angular_velocity = (int32_t) (state->angular_velocity * friction);
+}
 
-    call_handler_if_set(state, state->handlers.presented_angle_or_accel_data_changed);
-    state->timer = NULL;
-    schedule_update(state);
+DataProviderFrameStats data_provider_get_frame_stats(DataProvider *provider) {
+    DataProviderState *state = (DataProviderState *) provider;
+    return state->frame_stats;
+}
+
+DataProviderChanges data_provider_get_changes(DataProvider *provider) {
+    DataProviderState *state = (DataProviderState *) provider;
+    return state->changes;
+}
 
-    // once could optimize this and stop the updates once,
-    //
-    //    (int32_t)(attraction*state->friction) != 0 || state->angular_velocity != 0
-    //
-    // but in reality the compass input constantly changes
-    // to simplify dependent code (e.g. for transitions that require constant redraws)
-    // we simply loop infinitely
-    // be aware that this drains the battery!
+static void update_animating(DataProviderState *state) {
+    const bool animating = state->timer != NULL || state->orientation_animation != NULL;
+    if(state->animating == animating) return;
+
+    state->animating = animating;
+    call_handler_if_set(state, state->handlers.animating_changed);
+}
+
+// value * factor, truncated towards zero like the float to int conversion this replaces
+// 64 bit intermediate as angular values times factors > 1 can exceed 32 bit
+static int32_t fixed_mul(int32_t value, DataProviderFixed factor) {
+    return (int32_t) (((int64_t) value * factor) / DATA_PROVIDER_FIXED_ONE);
+}
+
+// angle in -TRIG_MAX_ANGLE/2...TRIG_MAX_ANGLE/2
+static int32_t wrap_angle(int32_t angle) {
+    while (angle < -TRIG_MAX_ANGLE / 2) angle += TRIG_MAX_ANGLE;
+    while (angle > +TRIG_MAX_ANGLE / 2) angle -= TRIG_MAX_ANGLE;
+    return angle;
+}
+
+static uint64_t now_ms(void) {
+    time_t seconds;
+    uint16_t milliseconds;
+    time_ms(&seconds, &milliseconds);
+    return (uint64_t) seconds * 1000 + milliseconds;
+}
+
+static DataProviderFixed modified_factor(DataProviderState *state, DataProviderFixed factor,
+        DataProviderModifyFixedFactorHandler fixed_modifier, DataProviderModifyFactorHandler float_modifier) {
+    if (fixed_modifier) {
+        return fixed_modifier((DataProvider *) state, factor, state->user_data);
+    }
+    if (float_modifier) {
+        // legacy path, only pays for floats if someone actually uses it
+        float f = float_modifier((DataProvider *) state, DATA_PROVIDER_FIXED_TO_FLOAT(factor), state->user_data);
+        return DATA_PROVIDER_FIXED_FROM_FLOAT(f);
+    }
+    return factor;
+}
+
+static void update_state(DataProviderState *state) {
+    state->presentation_angle = state->presentation_angle + state->angular_velocity;
+    const int32_t distance = wrap_angle(state->target_angle - state->presentation_angle);
+
+    const DataProviderFixed attraction_factor = modified_factor(state, state->attraction,
+            state->handlers.attraction_modifier_fixed, state->handlers.attraction_modifier);
+    state->angular_velocity += fixed_mul(distance, attraction_factor);
+
+    const DataProviderFixed friction = modified_factor(state, state->friction,
+            state->handlers.friction_modifier_fixed, state->handlers.friction_modifier);
+    state->angular_velocity = fixed_mul(state->angular_velocity, friction);
+
+    // park the loop once the needle came to rest, snap to the target so the presented degrees are exact
+    // anything that could move the needle again calls schedule_update()
+    const bool settled = abs(distance) < DATA_PROVIDER_SETTLE_THRESHOLD &&
+                         abs(state->angular_velocity) < DATA_PROVIDER_SETTLE_THRESHOLD;
+    if (settled) {
+        state->presentation_angle += distance;
+        state->angular_velocity = 0;
+        state->parked_accel_data = state->last_accel_data;
+        set_heading_filter_mode(state, DataProviderHeadingFilterCoarse);
+    } else if (abs(state->angular_velocity) > DATA_PROVIDER_FINE_HEADING_VELOCITY) {
+        set_heading_filter_mode(state, DataProviderHeadingFilterFine);
+    }
+
+    report_changes(state, state->handlers.presented_angle_or_accel_data_changed);
+    state->timer = NULL;
+    if (!settled) {
+        schedule_update(state);
+    }
+    update_animating(state);
 }
 
 int32_t data_provider_get_presentation_angle(DataProvider *provider) {
@@ -81,14 +308,21 @@ void data_provider_set_presentation_angle(DataProvider *provider, int32_t angle)
     DataProviderState *state = (DataProviderState *) provider;
     state->presentation_angle = angle;
     state->angular_velocity = 0;
+    schedule_update(state);
 }
 
 static void schedule_update(DataProviderState *state) {
     if(!state->timer) {
         state->timer = app_timer_register(1000 / DATA_PROVIDER_FPS, (AppTimerCallback) update_state, state);
+        update_animating(state);
     }
 }
 
+bool data_provider_is_animating(DataProvider *provider) {
+    DataProviderState *state = (DataProviderState *) provider;
+    return state->animating;
+}
+
 int32_t data_provider_get_target_angle(DataProvider *provider) {
     DataProviderState *state = (DataProviderState *) provider;
     return state->target_angle;
@@ -99,6 +333,8 @@ void data_provider_set_target_angle(DataProvider *provider, int32_t angle) {
     if (state->handlers.target_angle_modifier) {
         angle = state->handlers.target_angle_modifier(provider, angle, state->user_data);
     }
+    if(state->target_angle == angle) return;
+
     state->target_angle = angle;
     schedule_update(state);
 }
@@ -127,7 +363,7 @@ void data_provider_delta_heading_angle(DataProvider *provider, int32_t delta) {
 void data_provider_set_orientation_transition_factor(DataProvider* provider, float factor) {
     DataProviderState *state = (DataProviderState *) provider;
     state->orientation_transition_factor = factor;
-    call_handler_if_set(state, state->handlers.orientation_transition_factor_changed);
+    report_changes(state, state->handlers.orientation_transition_factor_changed);
 }
 
 float data_provider_get_orientation_transition_factor(DataProvider* provider) {
@@ -164,8 +400,14 @@ static AnimationImplementation transition_animation  = {
 };
 
 static void animation_stopped_handler(Animation *animation, bool finished, void *context) {
+  DataProviderState *state = context;
+  if(state->orientation_animation == animation) {
+    // SDK 3 destroys the animation after this handler returns
+    state->orientation_animation = NULL;
+    update_animating(state);
+  }
   #ifdef PBL_SDK_2
-    animation_destroy(anim);
+    animation_destroy(animation);
   #endif
 }
 
@@ -178,8 +420,10 @@ void data_provider_set_orientation(DataProvider *provider, DataProviderOrientati
 
     // TODO: refactor to make this a property animation
     if(state->orientation_animation) {
-      animation_unschedule(state->orientation_animation);
-
+      // forget it first, its stopped handler must not end the animating state
+      Animation *previous = state->orientation_animation;
+      state->orientation_animation = NULL;
+      animation_unschedule(previous);
     }
 
     state->orientation_animation = animation_create();
@@ -187,11 +431,15 @@ void data_provider_set_orientation(DataProvider *provider, DataProviderOrientati
     animation_set_implementation(state->orientation_animation, &transition_animation);
     animation_set_handlers(state->orientation_animation, (AnimationHandlers) {
       .started = NULL,
-      .stopped = NULL
+      .stopped = animation_stopped_handler
     }, state);
 
     state->orientation_animation_start_value = state->orientation_transition_factor;
     animation_schedule(state->orientation_animation);
+    update_animating(state);
+
+    // the transition redraws the needle, keep its physics running as well
+    schedule_update(state);
 }
 
 DataProviderOrientation data_provider_get_orientation(DataProvider *provider) {
@@ -202,68 +450,346 @@ DataProviderOrientation data_provider_get_orientation(DataProvider *provider) {
 // ---------------
 // accelerometer
 
-static void merge_accel_data(AccelData *dest, AccelData *next, float factor) {
+// next * weight + (1 - weight) * value, truncated towards zero like the float blend this replaces
+// |mG| < 2^13 keeps both products well inside 32 bit
+static int16_t accel_filter(int16_t value, int16_t next, DataProviderFixed weight) {
+    return (int16_t) ((next * weight + value * (DATA_PROVIDER_FIXED_ONE - weight)) / DATA_PROVIDER_FIXED_ONE);
+}
+
+static void merge_accel_data(AccelData *dest, const AccelData *next, DataProviderFixed weight) {
     *dest = (AccelData){
             .did_vibrate = next->did_vibrate,
             .timestamp = next->timestamp,
-            .x = (int16_t)(next->x * factor + (1 - factor) * dest->x),
-            .y = (int16_t)(next->y * factor + (1 - factor) * dest->y),
-            .z = (int16_t)(next->z * factor + (1 - factor) * dest->z),
+            .x = accel_filter(dest->x, next->x, weight),
+            .y = accel_filter(dest->y, next->y, weight),
+            .z = accel_filter(dest->z, next->z, weight),
     };
 }
 
-static void data_provider_handle_accel_data(AccelData *data, uint32_t num_samples) {
-    DataProviderState *state = dataProviderStateSingleton;
+static DataProviderOrientation orientation_for_accel_data(DataProviderOrientation orientation, const AccelData *damped) {
+    if(damped->y < -700) {
+        return DataProviderOrientationUpright;
+    } else if (damped->y > -500) {
+        return DataProviderOrientationFlat;
+    }
+    return orientation;
+}
+
+static uint32_t effective_accel_samples_per_update(DataProviderState *state) {
+    const uint32_t result = state->accel_samples_per_update * DATA_PROVIDER_ACCEL_RATES[state->accel_rate_level] / ACCEL_SAMPLING_50HZ;
+    if(result < 1) return 1;
+    if(result > DATA_PROVIDER_MAX_ACCEL_SAMPLES_PER_UPDATE) return DATA_PROVIDER_MAX_ACCEL_SAMPLES_PER_UPDATE;
+    return result;
+}
+
+static void set_accel_rate_level(DataProviderState *state, DataProviderAccelRateLevel level) {
+    if(state->accel_rate_level == level) return;
+
+    if(level > state->accel_rate_level) {
+        state->accel_rate_stats.num_rate_increases++;
+    } else {
+        state->accel_rate_stats.num_rate_decreases++;
+    }
+    state->accel_rate_level = (uint8_t) level;
+    state->accel_quiet_ms = 0;
+    accel_service_set_sampling_rate(DATA_PROVIDER_ACCEL_RATES[level]);
+    accel_service_set_samples_per_update(effective_accel_samples_per_update(state));
+}
+
+// steps the sampling rate up as soon as the motion energy crosses the upper threshold of a level
+// and down once it stayed below the lower one for a while, the gap between both avoids thrashing
+static void update_accel_rate(DataProviderState *state, uint32_t num_samples) {
+    const DataProviderAccelRateLevel level = (DataProviderAccelRateLevel) state->accel_rate_level;
+    const int32_t energy = state->accel_motion_energy;
+    state->accel_rate_stats.num_samples[level] += num_samples;
+
+    if(energy > DATA_PROVIDER_MOTION_FAST_ON) {
+        set_accel_rate_level(state, DataProviderAccelRateLevelFast);
+        return;
+    }
+    if(level == DataProviderAccelRateLevelStill) {
+        if(energy > DATA_PROVIDER_MOTION_MOVING) {
+            set_accel_rate_level(state, DataProviderAccelRateLevelNormal);
+        }
+        return;
+    }
+
+    const int32_t quiet_threshold = level == DataProviderAccelRateLevelFast ? DATA_PROVIDER_MOTION_FAST_OFF : DATA_PROVIDER_MOTION_STILL;
+    const uint32_t hold_ms = level == DataProviderAccelRateLevelFast ? DATA_PROVIDER_FAST_HOLD_MS : DATA_PROVIDER_STILL_HOLD_MS;
+    if(energy >= quiet_threshold) {
+        state->accel_quiet_ms = 0;
+        return;
+    }
+    state->accel_quiet_ms += num_samples * 1000 / DATA_PROVIDER_ACCEL_RATES[level];
+    if(state->accel_quiet_ms >= hold_ms) {
+        set_accel_rate_level(state, (DataProviderAccelRateLevel) (level - 1));
+    }
+}
+
+// complementary filter of the compass heading and the gravity vector
+// the compass API only provides headings, not the magnetic field, so the heading can't be rotated by the tilt
+// instead, headings measured while the gravity vector moves or doesn't look like gravity at all are mostly ignored
+static void fuse_heading(DataProviderState *state) {
+    const AccelData *g = &state->damped_accel_data;
+    const AccelData *p = &state->fusion_gravity;
+    const int32_t tilt = abs(g->x - p->x) + abs(g->y - p->y) + abs(g->z - p->z);
+    const int32_t magnitude_squared = g->x * g->x + g->y * g->y + g->z * g->z;
+    state->fusion_gravity = *g;
+    if(!state->heading_received) return;
+
+    DataProviderFixed weight = DATA_PROVIDER_FUSION_WEIGHT_STABLE;
+    if(state->accel_motion_energy > DATA_PROVIDER_MOTION_FAST_ON ||
+       magnitude_squared < DATA_PROVIDER_FUSION_MIN_GRAVITY * DATA_PROVIDER_FUSION_MIN_GRAVITY ||
+       magnitude_squared > DATA_PROVIDER_FUSION_MAX_GRAVITY * DATA_PROVIDER_FUSION_MAX_GRAVITY) {
+        weight = DATA_PROVIDER_FUSION_WEIGHT_SPIKE;
+    } else if(tilt > DATA_PROVIDER_FUSION_TILT_THRESHOLD) {
+        weight = DATA_PROVIDER_FUSION_WEIGHT_TILTING;
+    }
+
+    const int32_t fused = state->fused_heading + fixed_mul(wrap_angle(state->measured_heading - state->fused_heading), weight);
+    state->fused_heading = (fused + TRIG_MAX_ANGLE) % TRIG_MAX_ANGLE;
+    data_provider_set_target_angle((DataProvider *) state, state->fused_heading - state->compass_delta_angle);
+}
 
-    merge_accel_data(&state->last_accel_data, data, 0.99f);
-    merge_accel_data(&state->damped_accel_data, data, 0.3f);
+void data_provider_handle_accel_data(DataProvider *provider, AccelData *data, uint32_t num_samples) {
+    DataProviderState *state = (DataProviderState *) provider;
+    if(state->sensor_trace) {
+        sensor_trace_record_accel(state->sensor_trace, now_ms(), data, num_samples);
+    }
+    if(num_samples == 0) return;
+
+    // run the whole batch through the filters, the result is the same as for one sample per callback
+    // the orientation follows each sample but only the one after the last sample is applied
+    const DataProviderFixed last_weight = DATA_PROVIDER_LAST_ACCEL_WEIGHT[state->accel_rate_level];
+    const DataProviderFixed damped_weight = DATA_PROVIDER_DAMPED_ACCEL_WEIGHT[state->accel_rate_level];
+    DataProviderOrientation orientation = state->orientation;
+    if(!state->accel_data_received) {
+        // start the filters at the first sample, otherwise their settling looks like motion
+        state->accel_data_received = true;
+        state->last_accel_data = data[0];
+        state->damped_accel_data = data[0];
+    }
+    for(uint32_t i = 0; i < num_samples; i++) {
+        const AccelData *d = &state->damped_accel_data;
+        const int32_t motion = abs(data[i].x - d->x) + abs(data[i].y - d->y) + abs(data[i].z - d->z);
+        state->accel_motion_energy += (motion - state->accel_motion_energy) / 4;
+
+        merge_accel_data(&state->last_accel_data, &data[i], last_weight);
+        merge_accel_data(&state->damped_accel_data, &data[i], damped_weight);
+        orientation = orientation_for_accel_data(orientation, &state->damped_accel_data);
+    }
+    update_accel_rate(state, num_samples);
+    fuse_heading(state);
     call_handler_if_set(state, state->handlers.input_accel_data_changed);
 
-    if(state->damped_accel_data.y < -700) {
-        data_provider_set_orientation((DataProvider *)state, DataProviderOrientationUpright);
-    } else if (state->damped_accel_data.y > -500) {
-        data_provider_set_orientation((DataProvider *)state, DataProviderOrientationFlat);
+    // presented_angle_or_accel_data_changed is emitted by the update loop, wake it if the level moved
+    if(!state->timer) {
+        const AccelData *a = &state->last_accel_data;
+        const AccelData *p = &state->parked_accel_data;
+        if(abs(a->x - p->x) > DATA_PROVIDER_ACCEL_WAKE_THRESHOLD ||
+           abs(a->y - p->y) > DATA_PROVIDER_ACCEL_WAKE_THRESHOLD ||
+           abs(a->z - p->z) > DATA_PROVIDER_ACCEL_WAKE_THRESHOLD) {
+            schedule_update(state);
+        }
+    }
+
+    data_provider_set_orientation((DataProvider *)state, orientation);
+}
+
+void data_provider_set_accel_samples_per_update(DataProvider *provider, uint32_t num_samples) {
+    DataProviderState *state = (DataProviderState *) provider;
+    if(num_samples < 1) {
+        num_samples = 1;
+    } else if(num_samples > DATA_PROVIDER_MAX_ACCEL_SAMPLES_PER_UPDATE) {
+        num_samples = DATA_PROVIDER_MAX_ACCEL_SAMPLES_PER_UPDATE;
     }
+    if(state->accel_samples_per_update == num_samples) return;
+
+    state->accel_samples_per_update = num_samples;
+    accel_service_set_samples_per_update(effective_accel_samples_per_update(state));
+}
+
+uint32_t data_provider_get_accel_samples_per_update(DataProvider *provider) {
+    DataProviderState *state = (DataProviderState *) provider;
+    return state->accel_samples_per_update;
+}
+
+AccelSamplingRate data_provider_get_accel_sampling_rate(DataProvider *provider) {
+    DataProviderState *state = (DataProviderState *) provider;
+    return DATA_PROVIDER_ACCEL_RATES[state->accel_rate_level];
+}
+
+DataProviderAccelRateStats data_provider_get_accel_rate_stats(DataProvider *provider) {
+    DataProviderState *state = (DataProviderState *) provider;
+    return state->accel_rate_stats;
 }
 
 AccelData data_provider_last_accel_data(DataProvider *provider) {
-    DataProviderState *state = dataProviderStateSingleton;
+    DataProviderState *state = (DataProviderState *) provider;
     return state->last_accel_data;
 }
 
 AccelData data_provider_get_damped_accel_data(DataProvider *provider) {
-    DataProviderState *state = dataProviderStateSingleton;
+    DataProviderState *state = (DataProviderState *) provider;
     return state->damped_accel_data;
 }
 
 bool data_provider_compass_needs_calibration(DataProvider *provider) {
-    DataProviderState *state = dataProviderStateSingleton;
+    DataProviderState *state = (DataProviderState *) provider;
 
     return state->heading.compass_status == CompassStatusDataInvalid;
 }
 
 bool data_provider_is_influenced_by_magnetic_interference(DataProvider *provider) {
-    DataProviderState *state = dataProviderStateSingleton;
+    DataProviderState *state = (DataProviderState *) provider;
     bool result = state->battery_charge_state.is_plugged;
     return result;
 }
 
-static void data_provider_handle_compass_data(CompassHeadingData heading) {
-    DataProviderState *state = dataProviderStateSingleton;
+// ---------------
+// compass
+
+static void set_heading_filter_mode(DataProviderState *state, DataProviderHeadingFilterMode mode) {
+    if(state->heading_filter_mode == mode) return;
+
+    const uint64_t now = now_ms();
+    state->heading_filter_stats.duration_ms[state->heading_filter_mode] += (uint32_t) (now - state->heading_filter_mode_start_ms);
+    state->heading_filter_mode_start_ms = now;
+    state->heading_filter_mode = (uint8_t) mode;
+    compass_service_set_heading_filter(DATA_PROVIDER_HEADING_FILTERS[mode]);
+}
+
+DataProviderHeadingFilterMode data_provider_get_heading_filter_mode(DataProvider *provider) {
+    DataProviderState *state = (DataProviderState *) provider;
+    return (DataProviderHeadingFilterMode) state->heading_filter_mode;
+}
+
+DataProviderHeadingFilterStats data_provider_get_heading_filter_stats(DataProvider *provider) {
+    DataProviderState *state = (DataProviderState *) provider;
+    DataProviderHeadingFilterStats result = state->heading_filter_stats;
+    result.duration_ms[state->heading_filter_mode] += (uint32_t) (now_ms() - state->heading_filter_mode_start_ms);
+    return result;
+}
+
+uint32_t data_provider_heading_callbacks_per_minute(DataProviderHeadingFilterStats stats, DataProviderHeadingFilterMode mode) {
+    if(stats.duration_ms[mode] == 0) return 0;
+    return (uint32_t) ((uint64_t) stats.num_callbacks[mode] * 60000 / stats.duration_ms[mode]);
+}
+
+void data_provider_handle_compass_data(DataProvider *provider, CompassHeadingData heading) {
+    DataProviderState *state = (DataProviderState *) provider;
+    if(state->sensor_trace) {
+        sensor_trace_record_compass(state->sensor_trace, now_ms(), heading);
+    }
+    state->heading_filter_stats.num_callbacks[state->heading_filter_mode]++;
 
+    // dependent code switches to and from calibration in the update loop
+    if(state->heading.compass_status != heading.compass_status) {
+        schedule_update(state);
+    }
     state->heading = heading;
 
     // TODO: look at is_declination_valid and use true_heading if available (configured by user?)
-    data_provider_set_target_angle((DataProvider*)dataProviderStateSingleton, TRIG_MAX_ANGLE-heading.magnetic_heading - state->compass_delta_angle);
+    // the next accelerometer callback blends this into the target angle, see fuse_heading()
+    state->measured_heading = (TRIG_MAX_ANGLE - heading.magnetic_heading) % TRIG_MAX_ANGLE;
+    if(!state->heading_received) {
+        state->heading_received = true;
+        state->fused_heading = state->measured_heading;
+        data_provider_set_target_angle((DataProvider*)state, state->fused_heading - state->compass_delta_angle);
+    }
     call_handler_if_set(state, state->handlers.input_heading_changed);
 }
 
-static void data_provider_handle_battery(BatteryChargeState charge) {
-    DataProviderState *state = dataProviderStateSingleton;
+// ---------------
+// battery
+
+void data_provider_handle_battery_state(DataProvider *provider, BatteryChargeState charge) {
+    DataProviderState *state = (DataProviderState *) provider;
+    if(state->sensor_trace) {
+        sensor_trace_record_battery(state->sensor_trace, now_ms(), charge);
+    }
     state->battery_charge_state = charge;
     call_handler_if_set(state, state->handlers.magnetic_interference_changed);
 }
 
+// ---------------
+// sensor trace
+
+void data_provider_set_sensor_trace(DataProvider *provider, SensorTrace *trace) {
+    DataProviderState *state = (DataProviderState *) provider;
+    state->sensor_trace = trace;
+    if(!trace) return;
+
+    // callbacks only report changes, replay starts from the state they changed so far
+    // the heading is the default one until the first compass callback, replay has that default as well
+    const uint64_t now = now_ms();
+    sensor_trace_record_battery(trace, now, state->battery_charge_state);
+    if(state->heading_filter_stats.num_callbacks[DataProviderHeadingFilterCoarse] +
+       state->heading_filter_stats.num_callbacks[DataProviderHeadingFilterFine] > 0) {
+        sensor_trace_record_compass(trace, now, state->heading);
+    }
+}
+
+// ---------------
+// service dispatch
+
+// the Pebble services take handlers without a context and only one per app
+// the first provider subscribes, the callbacks are forwarded to all providers in this list
+// host tools run providers on several threads, each with its own services and list
+#ifndef HOST_THREAD_LOCAL
+#define HOST_THREAD_LOCAL
+#endif
+static HOST_THREAD_LOCAL DataProviderState *s_providers;
+
+static void dispatch_accel_data(AccelData *data, uint32_t num_samples) {
+    for(DataProviderState *state = s_providers, *next; state; state = next) {
+        next = state->next_provider;
+        data_provider_handle_accel_data((DataProvider *) state, data, num_samples);
+    }
+}
+
+static void dispatch_compass_data(CompassHeadingData heading) {
+    for(DataProviderState *state = s_providers, *next; state; state = next) {
+        next = state->next_provider;
+        data_provider_handle_compass_data((DataProvider *) state, heading);
+    }
+}
+
+static void dispatch_battery_state(BatteryChargeState charge) {
+    for(DataProviderState *state = s_providers, *next; state; state = next) {
+        next = state->next_provider;
+        data_provider_handle_battery_state((DataProvider *) state, charge);
+    }
+}
+
+static void add_provider(DataProviderState *state) {
+    state->next_provider = s_providers;
+    s_providers = state;
+    if(state->next_provider) {
+        // the services are shared, their configuration follows the provider that changed it last
+        accel_service_set_samples_per_update(effective_accel_samples_per_update(state));
+        return;
+    }
+
+    compass_service_subscribe(dispatch_compass_data);
+    accel_data_service_subscribe(effective_accel_samples_per_update(state), dispatch_accel_data);
+    battery_state_service_subscribe(dispatch_battery_state);
+}
+
+static void remove_provider(DataProviderState *state) {
+    for(DataProviderState **link = &s_providers; *link; link = &(*link)->next_provider) {
+        if(*link == state) {
+            *link = state->next_provider;
+            break;
+        }
+    }
+    if(s_providers) return;
+
+    accel_data_service_unsubscribe();
+    compass_service_unsubscribe();
+    battery_state_service_unsubscribe();
+}
+
 // ---------------
 // lifecycle
 
@@ -273,19 +799,21 @@ DataProvider *data_provider_create(void *user_data, DataProviderHandlers handler
     result->user_data = user_data;
     result->handlers = handlers;
 
-    result->friction = 0.9f;
-    result->attraction = 0.05f;
+    result->friction = DATA_PROVIDER_FIXED_FROM_FLOAT(0.9f);
+    result->attraction = DATA_PROVIDER_FIXED_FROM_FLOAT(0.05f);
     result->heading.compass_status = CompassStatusCalibrated; // assume calibrated data by default
 
-    dataProviderStateSingleton = result;
-
-    compass_service_subscribe(data_provider_handle_compass_data);
+    result->heading_filter_mode = DataProviderHeadingFilterCoarse;
+    result->heading_filter_mode_start_ms = now_ms();
+    compass_service_set_heading_filter(DATA_PROVIDER_HEADING_FILTERS[result->heading_filter_mode]);
 
-    accel_service_set_sampling_rate(ACCEL_SAMPLING_50HZ);
-    accel_data_service_subscribe(1, data_provider_handle_accel_data);
+    // start at 50Hz, update_accel_rate() adapts the rate to the motion from there
+    result->accel_rate_level = DataProviderAccelRateLevelNormal;
+    result->accel_samples_per_update = DATA_PROVIDER_DEFAULT_ACCEL_SAMPLES_PER_UPDATE;
+    accel_service_set_sampling_rate(DATA_PROVIDER_ACCEL_RATES[result->accel_rate_level]);
 
     result->battery_charge_state = battery_state_service_peek();
-    battery_state_service_subscribe(data_provider_handle_battery);
+    add_provider(result);
 
     schedule_update(result);
 
@@ -299,13 +827,14 @@ void data_provider_destroy(DataProvider *provider) {
     if(state->timer) {
         app_timer_cancel(state->timer);
     }
-    accel_data_service_unsubscribe();
-    compass_service_unsubscribe();
+    if(state->frame_timer) {
+        app_timer_cancel(state->frame_timer);
+    }
+    if(state->orientation_animation) {
+        animation_set_handlers(state->orientation_animation, (AnimationHandlers) {}, NULL);
+        animation_unschedule(state->orientation_animation);
+    }
+    remove_provider(state);
 
     free(provider);
-
-    // singletons suck!
-    if(dataProviderStateSingleton == state) {
-        dataProviderStateSingleton = NULL;
-    }
 }
@@ -1,10 +1,20 @@
+#pragma once
+
 #include "pebble.h"
+#include "sensor_trace.h"
 
 typedef struct DataProvider DataProvider;
 
+// Q16.16 fixed point number, the physics use these to stay deterministic and free of soft-float on aplite
+typedef int32_t DataProviderFixed;
+#define DATA_PROVIDER_FIXED_ONE ((DataProviderFixed)1 << 16)
+#define DATA_PROVIDER_FIXED_FROM_FLOAT(f) ((DataProviderFixed)((f) * DATA_PROVIDER_FIXED_ONE + ((f) < 0 ? -0.5f : 0.5f)))
+#define DATA_PROVIDER_FIXED_TO_FLOAT(f) ((float)(f) / DATA_PROVIDER_FIXED_ONE)
+
 typedef void (*DataProviderHandler)(DataProvider *provider, void *user_data);
 typedef int32_t (*DataProviderModifyAngleHandler)(DataProvider *provider, int32_t angle, void *user_data);
 typedef float (*DataProviderModifyFactorHandler)(DataProvider *provider, float factor, void *user_data);
+typedef DataProviderFixed (*DataProviderModifyFixedFactorHandler)(DataProvider *provider, DataProviderFixed factor, void *user_data);
 
 typedef struct {
     DataProviderHandler input_heading_changed;
@@ -13,12 +23,31 @@ typedef struct {
     DataProviderHandler orientation_transition_factor_changed;
     DataProviderHandler input_accel_data_changed;
     DataProviderHandler presented_angle_or_accel_data_changed;
+    // the two above combined, at most once per frame of the update loop, see data_provider_get_frame_stats()
+    DataProviderHandler presentation_changed;
     DataProviderHandler magnetic_interference_changed;
+    // the provider stops updating once the needle came to rest, see data_provider_is_animating()
+    DataProviderHandler animating_changed;
     DataProviderModifyAngleHandler target_angle_modifier;
     DataProviderModifyFactorHandler attraction_modifier;
     DataProviderModifyFactorHandler friction_modifier;
+    // fixed point variants of the modifiers above, take precedence if set
+    DataProviderModifyFixedFactorHandler attraction_modifier_fixed;
+    DataProviderModifyFixedFactorHandler friction_modifier_fixed;
 } DataProviderHandlers;
 
+// inputs of the presentation, see data_provider_get_changes()
+typedef enum {
+    DataProviderChangeNone = 0,
+    // data_provider_get_presentation_angle()
+    DataProviderChangeHeading = 1 << 0,
+    // data_provider_last_accel_data()
+    DataProviderChangeLevel = 1 << 1,
+    // data_provider_get_orientation_transition_factor()
+    DataProviderChangeTransition = 1 << 2,
+    DataProviderChangeAll = DataProviderChangeHeading | DataProviderChangeLevel | DataProviderChangeTransition,
+} DataProviderChanges;
+
 typedef enum {
     DataProviderOrientationFlat = 0,
     DataProviderOrientationUpright = 1,
@@ -27,6 +56,13 @@ typedef enum {
 DataProvider *data_provider_create(void *user_data, DataProviderHandlers handlers);
 void data_provider_destroy(DataProvider *pProvider);
 
+// every provider receives the data of the compass, accelerometer and battery services
+// the services are shared, the sampling rate and heading filter follow the provider that changed them last
+// these functions feed a single provider directly, e.g. to replay recorded data into one of many
+void data_provider_handle_compass_data(DataProvider *provider, CompassHeadingData heading);
+void data_provider_handle_accel_data(DataProvider *provider, AccelData *data, uint32_t num_samples);
+void data_provider_handle_battery_state(DataProvider *provider, BatteryChargeState charge);
+
 int32_t data_provider_get_presentation_angle(DataProvider *provider);
 void data_provider_set_presentation_angle(DataProvider *provider, int32_t angle);
 
@@ -42,13 +78,72 @@ void data_provider_delta_heading_angle(DataProvider *provider, int32_t angle);
 DataProviderOrientation data_provider_get_orientation(DataProvider *provider);
 void data_provider_set_orientation(DataProvider *provider, DataProviderOrientation orientation);
 
+// number of accelerometer samples delivered per callback at 50Hz (1...25, default 5)
+// other sampling rates scale this to keep the time between callbacks
+// samples are filtered one by one either way, handlers are called once per callback
+void data_provider_set_accel_samples_per_update(DataProvider *provider, uint32_t num_samples);
+uint32_t data_provider_get_accel_samples_per_update(DataProvider *provider);
+
+// the accelerometer runs at 10Hz while the watch is still, at 50Hz while it moves and at 100Hz while it moves a lot
+AccelSamplingRate data_provider_get_accel_sampling_rate(DataProvider *provider);
+
+typedef struct {
+    uint32_t num_rate_increases;
+    uint32_t num_rate_decreases;
+    // samples received at 10Hz, 50Hz and 100Hz, divide by the rate to get the time spent at each
+    uint32_t num_samples[3];
+} DataProviderAccelRateStats;
+
+DataProviderAccelRateStats data_provider_get_accel_rate_stats(DataProvider *provider);
+
 AccelData data_provider_last_accel_data(DataProvider *provider);
 AccelData data_provider_get_damped_accel_data(DataProvider *provider);
 
 bool data_provider_compass_needs_calibration(DataProvider *provider);
 
+// the provider asks for coarse heading updates while the needle rests and for fine ones while it turns
+typedef enum {
+    DataProviderHeadingFilterCoarse = 0,
+    DataProviderHeadingFilterFine = 1,
+} DataProviderHeadingFilterMode;
+
+typedef struct {
+    // compass callbacks received and time spent in each DataProviderHeadingFilterMode
+    uint32_t num_callbacks[2];
+    uint32_t duration_ms[2];
+} DataProviderHeadingFilterStats;
+
+DataProviderHeadingFilterMode data_provider_get_heading_filter_mode(DataProvider *provider);
+DataProviderHeadingFilterStats data_provider_get_heading_filter_stats(DataProvider *provider);
+uint32_t data_provider_heading_callbacks_per_minute(DataProviderHeadingFilterStats stats, DataProviderHeadingFilterMode mode);
+
+// true while the needle moves or the orientation transition runs
+// presented_angle_or_accel_data_changed and orientation_transition_factor_changed are only emitted while animating
+bool data_provider_is_animating(DataProvider *provider);
+
+// while presented_angle_or_accel_data_changed or orientation_transition_factor_changed run, the inputs that changed
+// since either of them ran last, the first report has all of them, DataProviderChangeNone outside of these handlers
+// while presentation_changed runs, all inputs that changed since it ran last
+DataProviderChanges data_provider_get_changes(DataProvider *provider);
+
+typedef struct {
+    // presentation_changed calls
+    uint32_t num_frames;
+    // changes that joined a frame already waiting for its delivery
+    uint32_t num_coalesced;
+    // updates that changed nothing and didn't cause a frame
+    uint32_t num_skipped;
+} DataProviderFrameStats;
+
+DataProviderFrameStats data_provider_get_frame_stats(DataProvider *provider);
+
 bool data_provider_is_influenced_by_magnetic_interference(DataProvider *provider);
 
+// records the current battery state and heading, then every compass, accelerometer and battery callback into trace
+// until it's full, pass NULL to stop
+// the trace isn't owned by the provider, see sensor_trace.h
+void data_provider_set_sensor_trace(DataProvider *provider, SensorTrace *trace);
+
 // NOTE: for debugging only
 float data_provider_get_orientation_transition_factor(DataProvider* provider);
 void data_provider_set_orientation_transition_factor(DataProvider* provider, float factor);
@@ -0,0 +1,289 @@
+#include "sensor_trace.h"
+
+static const uint8_t SENSOR_TRACE_HEADER[] = {'C', 'T', 'R', 1};
+
+// a record never gets longer than this, the largest one is an accelerometer batch with 25 samples
+#define SENSOR_TRACE_MAX_RECORD_SIZE (1 + 10 + 5 + 5 + SENSOR_TRACE_MAX_ACCEL_SAMPLES * (3 * 3 + 10))
+
+// bytes per line of sensor_trace_log()
+#define SENSOR_TRACE_LOG_BYTES_PER_LINE 48
+
+struct SensorTrace {
+    uint8_t *data;
+    size_t capacity;
+    size_t size;
+    bool full;
+    bool has_time;
+    uint64_t time_ms;
+    // previous values the next record is relative to
+    CompassHeadingData heading;
+    AccelData sample;
+};
+
+// ---------------
+// varints
+
+static uint8_t *write_varint(uint8_t *p, uint64_t value) {
+    while (value >= 0x80) {
+        *p++ = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t) value;
+    return p;
+}
+
+static uint8_t *write_signed_varint(uint8_t *p, int64_t value) {
+    // zigzag, small negative numbers become small positive ones
+    return write_varint(p, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+}
+
+static bool read_varint(SensorTraceReader *reader, uint64_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (reader->offset >= reader->size) return false;
+        const uint8_t byte = reader->data[reader->offset++];
+        result |= (uint64_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool read_signed_varint(SensorTraceReader *reader, int64_t *value) {
+    uint64_t zigzag;
+    if (!read_varint(reader, &zigzag)) return false;
+    *value = (int64_t) (zigzag >> 1) ^ -(int64_t) (zigzag & 1);
+    return true;
+}
+
+static bool read_byte(SensorTraceReader *reader, uint8_t *value) {
+    if (reader->offset >= reader->size) return false;
+    *value = reader->data[reader->offset++];
+    return true;
+}
+
+// ---------------
+// recording
+
+SensorTrace *sensor_trace_create(size_t capacity) {
+    if (capacity < sizeof(SENSOR_TRACE_HEADER)) return NULL;
+
+    SensorTrace *result = malloc(sizeof(SensorTrace));
+    if (!result) return NULL;
+    memset(result, 0, sizeof(SensorTrace));
+    result->data = malloc(capacity);
+    if (!result->data) {
+        free(result);
+        return NULL;
+    }
+    result->capacity = capacity;
+    memcpy(result->data, SENSOR_TRACE_HEADER, sizeof(SENSOR_TRACE_HEADER));
+    result->size = sizeof(SENSOR_TRACE_HEADER);
+    return result;
+}
+
+void sensor_trace_destroy(SensorTrace *trace) {
+    if (!trace) return;
+    free(trace->data);
+    free(trace);
+}
+
+// writes the tag and the time of a record into buffer
+static uint8_t *begin_record(SensorTrace *trace, uint8_t *buffer, SensorTraceEventType type, uint64_t time_ms) {
+    const uint64_t delta = trace->has_time && time_ms > trace->time_ms ? time_ms - trace->time_ms : 0;
+    *buffer++ = (uint8_t) type;
+    return write_varint(buffer, delta);
+}
+
+// appends the record if there's room, the time only advances with records that made it into the trace
+static bool end_record(SensorTrace *trace, const uint8_t *buffer, const uint8_t *end, uint64_t time_ms) {
+    const size_t size = (size_t) (end - buffer);
+    if (trace->full || trace->size + size > trace->capacity) {
+        trace->full = true;
+        return false;
+    }
+    memcpy(trace->data + trace->size, buffer, size);
+    trace->size += size;
+    if (!trace->has_time || time_ms > trace->time_ms) {
+        trace->time_ms = time_ms;
+    }
+    trace->has_time = true;
+    return true;
+}
+
+bool sensor_trace_record_compass(SensorTrace *trace, uint64_t time_ms, CompassHeadingData heading) {
+    if (trace->full) return false;
+
+    uint8_t buffer[SENSOR_TRACE_MAX_RECORD_SIZE];
+    uint8_t *p = begin_record(trace, buffer, SensorTraceEventCompass, time_ms);
+    p = write_signed_varint(p, (int64_t) heading.magnetic_heading - trace->heading.magnetic_heading);
+    p = write_signed_varint(p, (int64_t) heading.true_heading - trace->heading.true_heading);
+    *p++ = (uint8_t) ((heading.compass_status & 0x7f) | (heading.is_declination_valid ? 0x80 : 0));
+    if (!end_record(trace, buffer, p, time_ms)) return false;
+
+    trace->heading = heading;
+    return true;
+}
+
+bool sensor_trace_record_accel(SensorTrace *trace, uint64_t time_ms, const AccelData *samples, uint32_t num_samples) {
+    if (trace->full) return false;
+    if (num_samples > SENSOR_TRACE_MAX_ACCEL_SAMPLES) {
+        num_samples = SENSOR_TRACE_MAX_ACCEL_SAMPLES;
+    }
+
+    uint8_t buffer[SENSOR_TRACE_MAX_RECORD_SIZE];
+    uint8_t *p = begin_record(trace, buffer, SensorTraceEventAccel, time_ms);
+    p = write_varint(p, num_samples);
+    uint32_t vibration_mask = 0;
+    for (uint32_t i = 0; i < num_samples; i++) {
+        vibration_mask |= samples[i].did_vibrate ? 1u << i : 0;
+    }
+    p = write_varint(p, vibration_mask);
+
+    AccelData previous = trace->sample;
+    for (uint32_t i = 0; i < num_samples; i++) {
+        p = write_signed_varint(p, samples[i].x - previous.x);
+        p = write_signed_varint(p, samples[i].y - previous.y);
+        p = write_signed_varint(p, samples[i].z - previous.z);
+        p = write_signed_varint(p, (int64_t) (samples[i].timestamp - previous.timestamp));
+        previous = samples[i];
+    }
+    if (!end_record(trace, buffer, p, time_ms)) return false;
+
+    trace->sample = previous;
+    return true;
+}
+
+bool sensor_trace_record_battery(SensorTrace *trace, uint64_t time_ms, BatteryChargeState charge) {
+    if (trace->full) return false;
+
+    uint8_t buffer[SENSOR_TRACE_MAX_RECORD_SIZE];
+    uint8_t *p = begin_record(trace, buffer, SensorTraceEventBattery, time_ms);
+    *p++ = charge.charge_percent;
+    *p++ = (uint8_t) ((charge.is_charging ? 1 : 0) | (charge.is_plugged ? 2 : 0));
+    return end_record(trace, buffer, p, time_ms);
+}
+
+const uint8_t *sensor_trace_get_data(SensorTrace *trace, size_t *size) {
+    *size = trace->size;
+    return trace->data;
+}
+
+bool sensor_trace_is_full(SensorTrace *trace) {
+    return trace->full;
+}
+
+void sensor_trace_log(SensorTrace *trace) {
+    static const char hex_digits[] = "0123456789abcdef";
+    char line[SENSOR_TRACE_LOG_BYTES_PER_LINE * 2 + 1];
+
+    for (size_t offset = 0; offset < trace->size; offset += SENSOR_TRACE_LOG_BYTES_PER_LINE) {
+        size_t length = trace->size - offset;
+        if (length > SENSOR_TRACE_LOG_BYTES_PER_LINE) {
+            length = SENSOR_TRACE_LOG_BYTES_PER_LINE;
+        }
+        for (size_t i = 0; i < length; i++) {
+            line[i * 2] = hex_digits[trace->data[offset + i] >> 4];
+            line[i * 2 + 1] = hex_digits[trace->data[offset + i] & 0xf];
+        }
+        line[length * 2] = '\0';
+        APP_LOG(APP_LOG_LEVEL_INFO, "sensor trace %06x: %s", (unsigned int) offset, line);
+    }
+    APP_LOG(APP_LOG_LEVEL_INFO, "sensor trace end, %u bytes%s", (unsigned int) trace->size, trace->full ? ", full" : "");
+}
+
+// ---------------
+// reading
+
+bool sensor_trace_reader_init(SensorTraceReader *reader, const uint8_t *data, size_t size) {
+    memset(reader, 0, sizeof(SensorTraceReader));
+    if (size < sizeof(SENSOR_TRACE_HEADER) || memcmp(data, SENSOR_TRACE_HEADER, sizeof(SENSOR_TRACE_HEADER)) != 0) {
+        return false;
+    }
+    reader->data = data;
+    reader->size = size;
+    reader->offset = sizeof(SENSOR_TRACE_HEADER);
+    return true;
+}
+
+static bool read_compass(SensorTraceReader *reader, SensorTraceEvent *event) {
+    int64_t magnetic, true_heading;
+    uint8_t status;
+    if (!read_signed_varint(reader, &magnetic) || !read_signed_varint(reader, &true_heading) || !read_byte(reader, &status)) {
+        return false;
+    }
+    reader->heading = (CompassHeadingData) {
+        .magnetic_heading = (CompassHeading) (reader->heading.magnetic_heading + magnetic),
+        .true_heading = (CompassHeading) (reader->heading.true_heading + true_heading),
+        .compass_status = (CompassStatus) (status & 0x7f),
+        .is_declination_valid = (status & 0x80) != 0,
+    };
+    event->heading = reader->heading;
+    return true;
+}
+
+static bool read_accel(SensorTraceReader *reader, SensorTraceEvent *event) {
+    uint64_t num_samples, vibration_mask;
+    if (!read_varint(reader, &num_samples) || num_samples > SENSOR_TRACE_MAX_ACCEL_SAMPLES ||
+        !read_varint(reader, &vibration_mask)) {
+        return false;
+    }
+    event->accel.num_samples = (uint32_t) num_samples;
+    for (uint32_t i = 0; i < num_samples; i++) {
+        int64_t x, y, z, timestamp;
+        if (!read_signed_varint(reader, &x) || !read_signed_varint(reader, &y) ||
+            !read_signed_varint(reader, &z) || !read_signed_varint(reader, &timestamp)) {
+            return false;
+        }
+        reader->sample = (AccelData) {
+            .x = (int16_t) (reader->sample.x + x),
+            .y = (int16_t) (reader->sample.y + y),
+            .z = (int16_t) (reader->sample.z + z),
+            .did_vibrate = (vibration_mask & (1u << i)) != 0,
+            .timestamp = reader->sample.timestamp + (uint64_t) timestamp,
+        };
+        event->accel.samples[i] = reader->sample;
+    }
+    return true;
+}
+
+static bool read_battery(SensorTraceReader *reader, SensorTraceEvent *event) {
+    uint8_t percent, flags;
+    if (!read_byte(reader, &percent) || !read_byte(reader, &flags)) {
+        return false;
+    }
+    event->battery = (BatteryChargeState) {
+        .charge_percent = percent,
+        .is_charging = (flags & 1) != 0,
+        .is_plugged = (flags & 2) != 0,
+    };
+    return true;
+}
+
+bool sensor_trace_reader_next(SensorTraceReader *reader, SensorTraceEvent *event) {
+    uint8_t tag;
+    uint64_t delta;
+    if (!read_byte(reader, &tag) || !read_varint(reader, &delta)) {
+        return false;
+    }
+    // a delta that overflows the 32-bit trace time would silently wrap, only a corrupt trace has one
+    if (delta > UINT32_MAX - reader->time_ms) {
+        return false;
+    }
+    reader->time_ms += (uint32_t) delta;
+    event->type = (SensorTraceEventType) tag;
+    event->time_ms = reader->time_ms;
+
+    switch (tag) {
+        case SensorTraceEventCompass:
+            return read_compass(reader, event);
+        case SensorTraceEventAccel:
+            return read_accel(reader, event);
+        case SensorTraceEventBattery:
+            return read_battery(reader, event);
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "pebble.h"
+
+// compact recording of the compass, accelerometer and battery callbacks the data provider receives
+// replaying a trace on the host reproduces a session from the field, see host/replay.c
+//
+// the format starts with "CTR" and a version byte, followed by one record per callback:
+// - a tag byte, the SensorTraceEventType
+// - the milliseconds since the previous record as unsigned LEB128 varint
+// - the payload, numbers are varints as well, signed ones zigzag encoded and relative to the previous record of the same type
+//   compass: magnetic_heading, true_heading, status byte (compass_status | is_declination_valid << 7)
+//   accel: num_samples, vibration mask (bit i is did_vibrate of sample i), per sample x, y, z and timestamp
+//   battery: charge_percent byte, flags byte (is_charging | is_plugged << 1)
+// the first records at time 0 are the battery state and, if known, the heading when recording started
+
+typedef struct SensorTrace SensorTrace;
+
+#define SENSOR_TRACE_MAX_ACCEL_SAMPLES 25
+
+typedef enum {
+    SensorTraceEventCompass = 0,
+    SensorTraceEventAccel = 1,
+    SensorTraceEventBattery = 2,
+} SensorTraceEventType;
+
+typedef struct {
+    SensorTraceEventType type;
+    // milliseconds since the first record
+    uint32_t time_ms;
+    // only the member matching type is set
+    CompassHeadingData heading;
+    struct {
+        uint32_t num_samples;
+        AccelData samples[SENSOR_TRACE_MAX_ACCEL_SAMPLES];
+    } accel;
+    BatteryChargeState battery;
+} SensorTraceEvent;
+
+//! creates a trace that records up to capacity bytes, recording stops once it's full
+SensorTrace *sensor_trace_create(size_t capacity);
+void sensor_trace_destroy(SensorTrace *trace);
+
+//! time_ms is any monotonic clock in milliseconds, only differences are stored
+//! return false if the trace is full
+bool sensor_trace_record_compass(SensorTrace *trace, uint64_t time_ms, CompassHeadingData heading);
+bool sensor_trace_record_accel(SensorTrace *trace, uint64_t time_ms, const AccelData *samples, uint32_t num_samples);
+bool sensor_trace_record_battery(SensorTrace *trace, uint64_t time_ms, BatteryChargeState charge);
+
+//! the recorded bytes, valid until the next record or sensor_trace_destroy()
+const uint8_t *sensor_trace_get_data(SensorTrace *trace, size_t *size);
+bool sensor_trace_is_full(SensorTrace *trace);
+
+//! writes the trace as hex to the app log, "pebble logs" captures it and host/replay.c reads it back
+void sensor_trace_log(SensorTrace *trace);
+
+// ---------------
+// reading
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    size_t offset;
+    uint32_t time_ms;
+    // previous values the next record is relative to
+    CompassHeadingData heading;
+    AccelData sample;
+} SensorTraceReader;
+
+//! returns false if data doesn't start with the header of a trace
+bool sensor_trace_reader_init(SensorTraceReader *reader, const uint8_t *data, size_t size);
+
+//! decodes the next record, returns false at the end of the trace or if the rest of it is corrupt
+bool sensor_trace_reader_next(SensorTraceReader *reader, SensorTraceEvent *event);
@@ -3,11 +3,59 @@
 #define MIN(X, Y) ((X) < (Y) ? (X) : (Y))
 #define MAX(X, Y) ((X) > (Y) ? (X) : (Y))
 
+#define TICKS_LAYER_NUM_TICKS 32
+#define TICKS_LAYER_NUM_LETTERS 4
+
+// everything ticks_layer_update_proc() draws, only recomputed if one of the inputs changes
 typedef struct {
+    // inputs
+    bool valid;
+    GRect bounds;
     int32_t angle;
     float transition_factor;
+
+    // outputs
+    GPoint tick_inner[TICKS_LAYER_NUM_TICKS];
+    GPoint tick_outer[TICKS_LAYER_NUM_TICKS];
+    bool has_north;
+    GPoint north[3];
+    GPoint letters[TICKS_LAYER_NUM_LETTERS];
+} TicksLayerGeometry;
+
+typedef struct {
+    int32_t angle;
+    float transition_factor;
+    TicksLayerGeometry geometry;
 } TicksLayerData;
 
+// per frame state to map an angle and radius to a point, shared by all points of a frame
+typedef struct {
+    GPoint center;
+    int32_t angle;
+    int32_t sin;
+    int32_t cos;
+    int32_t band_width;
+    int32_t band_base_y;
+    int32_t transition; // Q16.16
+} TicksLayerTransform;
+
+// unit vectors of the tick angles, scaled by TRIG_MAX_RATIO
+// rotating these by the layer's angle replaces two trig lookups per point
+static int32_t s_tick_sin[TICKS_LAYER_NUM_TICKS];
+static int32_t s_tick_cos[TICKS_LAYER_NUM_TICKS];
+static bool s_tick_unit_vectors_initialized;
+
+static void init_tick_unit_vectors(void) {
+    if (s_tick_unit_vectors_initialized) return;
+    s_tick_unit_vectors_initialized = true;
+
+    for (int i = 0; i < TICKS_LAYER_NUM_TICKS; i++) {
+        const int32_t angle = TRIG_MAX_ANGLE * i / TICKS_LAYER_NUM_TICKS;
+        s_tick_sin[i] = sin_lookup(angle);
+        s_tick_cos[i] = cos_lookup(angle);
+    }
+}
+
 Layer *ticks_layer_get_layer(TicksLayer* ticksLayer) {
     return (Layer*)ticksLayer;
 }
@@ -20,46 +68,67 @@ static TicksLayerData *ticks_layer_get_ticks_data(TicksLayer *layer) {
     return layer_get_ticks_data((Layer*)layer);
 }
 
-static GPoint point_from_center(TicksLayer* layer, int32_t angle, int32_t radius) {
-    // this is the heart of the smooth transition
-    // it calculates two coordinates "rose" (polar) and "band" (cartesian) to blend between them
-
-    // TODO: get rid of floats
-
-    const GRect bounds = layer_get_bounds(ticks_layer_get_layer(layer));
-    const GPoint center = grect_center_point(&bounds);
-    const TicksLayerData *data = ticks_layer_get_ticks_data(layer);
+static TicksLayerTransform ticks_layer_transform(const TicksLayerData *data, GRect bounds) {
+    return (TicksLayerTransform) {
+        .center = grect_center_point(&bounds),
+        .angle = data->angle,
+        .sin = sin_lookup(data->angle),
+        .cos = cos_lookup(data->angle),
+        .band_width = bounds.size.w + bounds.size.h,
+        .band_base_y = bounds.size.h * 7 / 10,
+        .transition = (int32_t) (data->transition_factor * (1 << 16)),
+    };
+}
 
+// this is the heart of the smooth transition
+// it calculates two coordinates "rose" (polar) and "band" (cartesian) to blend between them
+// xx and yy are the unit vector of angle, already rotated by the layer's angle
+static GPoint transformed_point(const TicksLayerTransform *t, int32_t angle, int32_t xx, int32_t yy, int32_t radius) {
     // polar
-    const int32_t xx = sin_lookup(-data->angle + angle);
-    const int32_t yy = -cos_lookup(-data->angle + angle);
-
     GPoint polar = (GPoint){
-        (int16_t)(xx * radius / TRIG_MAX_RATIO) + center.x,
-        (int16_t)(yy * radius / TRIG_MAX_RATIO) + center.y,
+        (int16_t)(xx * radius / TRIG_MAX_RATIO) + t->center.x,
+        (int16_t)(yy * radius / TRIG_MAX_RATIO) + t->center.y,
     };
+    if (t->transition == 0) {
+        return polar;
+    }
 
     // cartesian
-    int32_t delta = (angle - data->angle) % TRIG_MAX_ANGLE;
+    int32_t delta = (angle - t->angle) % TRIG_MAX_ANGLE;
     while(delta > +TRIG_MAX_ANGLE / 2)delta -= TRIG_MAX_ANGLE;
     while(delta < -TRIG_MAX_ANGLE / 2)delta += TRIG_MAX_ANGLE;
 
-    int32_t factor = bounds.size.w + bounds.size.h;
     GPoint cartesian = (GPoint){
-        (int16_t) (center.x + (delta * factor / TRIG_MAX_ANGLE)),
-        (int16_t) (center.y - 2*radius + bounds.size.h * 0.7f)
+        (int16_t) (t->center.x + (delta * t->band_width / TRIG_MAX_ANGLE)),
+        (int16_t) (t->center.y - 2*radius + t->band_base_y)
     };
 
-    float f = data->transition_factor;
-
+    const int32_t f = t->transition;
     return (GPoint){
-            (int16_t) (cartesian.x * f + (1-f) * polar.x),
-            (int16_t) (cartesian.y * f + (1-f) * polar.y),
+            (int16_t) ((cartesian.x * f + ((1 << 16) - f) * polar.x) / (1 << 16)),
+            (int16_t) ((cartesian.y * f + ((1 << 16) - f) * polar.y) / (1 << 16)),
     };
 }
 
+static GPoint point_from_center(const TicksLayerTransform *t, int32_t angle, int32_t radius) {
+    const int32_t xx = sin_lookup(-t->angle + angle);
+    const int32_t yy = -cos_lookup(-t->angle + angle);
+    return transformed_point(t, angle, xx, yy, radius);
+}
+
+static GPoint tick_point(const TicksLayerTransform *t, int tick_idx, int32_t radius) {
+    // sin(a - b) and -cos(a - b) with a being the tick's angle and b the layer's angle
+    const int32_t xx = (int32_t) (((int64_t) s_tick_sin[tick_idx] * t->cos - (int64_t) s_tick_cos[tick_idx] * t->sin) / TRIG_MAX_RATIO);
+    const int32_t yy = (int32_t) -(((int64_t) s_tick_cos[tick_idx] * t->cos + (int64_t) s_tick_sin[tick_idx] * t->sin) / TRIG_MAX_RATIO);
+    return transformed_point(t, TRIG_MAX_ANGLE * tick_idx / TICKS_LAYER_NUM_TICKS, xx, yy, radius);
+}
+
+static bool is_polar(float transition_factor) {
+    return transition_factor <= 0.01f;
+}
+
 static bool ticks_layer_is_polar(TicksLayer *layer) {
-    return ticks_layer_get_ticks_data(layer)->transition_factor <= 0.01f;
+    return is_polar(ticks_layer_get_ticks_data(layer)->transition_factor);
 }
 
 static int32_t tick_len(TicksLayer *layer, int tick_idx) {
@@ -73,53 +142,87 @@ static int32_t tick_len(TicksLayer *layer, int tick_idx) {
     }
 }
 
-static void ticks_layer_update_proc(Layer *layer, GContext *ctx) {
-    TicksLayer *ticks_layer = (TicksLayer *)layer;
-    TicksLayerData *data = layer_get_ticks_data(layer);
-    const GRect bounds = layer_get_bounds(layer);
+static int32_t ticks_layer_outer_radius(GRect bounds) {
+    return MIN(bounds.size.w, bounds.size.h) / 2;
+}
 
-    const int32_t r2 = (MIN(bounds.size.w, bounds.size.h) / 2);
+// N, E, S, W sit on every 8th tick
+static int letter_tick_idx(int letter_idx) {
+    return letter_idx * TICKS_LAYER_NUM_TICKS / TICKS_LAYER_NUM_LETTERS;
+}
 
-    graphics_context_set_stroke_color(ctx, GColorWhite);
-    graphics_context_set_fill_color(ctx, GColorWhite);
+static const TicksLayerGeometry *ticks_layer_update_geometry(TicksLayer *ticks_layer, GRect bounds) {
+    TicksLayerData *data = ticks_layer_get_ticks_data(ticks_layer);
+    TicksLayerGeometry *geometry = &data->geometry;
 
-    // draw ticks
-    {
-        const int num_ticks = 32;
-
-        for (int i = 0; i < num_ticks; i++) {
-            int32_t angle = (int32_t) (TRIG_MAX_ANGLE * i / num_ticks);
-            int32_t len = tick_len(ticks_layer, i);
-            const int32_t r1 = r2 - len;
-
-            #if defined(PBL_COLOR)
-              if(len == 2) {
-                graphics_context_set_stroke_color(ctx, GColorDarkGray);
-              }
-              else {
-                graphics_context_set_stroke_color(ctx, GColorWhite);
-              }
-            #endif
-
-            const GPoint inner = point_from_center(ticks_layer, angle, r1);
-            const GPoint outer = point_from_center(ticks_layer, angle, r2);
-
-            graphics_draw_line(ctx, inner, outer);
-        }
+    if (geometry->valid && geometry->angle == data->angle && geometry->transition_factor == data->transition_factor &&
+            grect_equal(&geometry->bounds, &bounds)) {
+        return geometry;
+    }
+    geometry->valid = true;
+    geometry->bounds = bounds;
+    geometry->angle = data->angle;
+    geometry->transition_factor = data->transition_factor;
+
+    const TicksLayerTransform t = ticks_layer_transform(data, bounds);
+    const int32_t r2 = ticks_layer_outer_radius(bounds);
+
+    for (int i = 0; i < TICKS_LAYER_NUM_TICKS; i++) {
+        const int32_t r1 = r2 - tick_len(ticks_layer, i);
+        geometry->tick_inner[i] = tick_point(&t, i, r1);
+        geometry->tick_outer[i] = tick_point(&t, i, r2);
     }
 
-    // draw north (can be omitted if fully transitioned to cartesian representation)
-    if(data->transition_factor < 1) {
+    // north (can be omitted if fully transitioned to cartesian representation)
+    geometry->has_north = data->transition_factor < 1;
+    if (geometry->has_north) {
         int32_t angle_polar = TRIG_MAX_ANGLE * 5 / 360;
         int32_t angle = (int32_t) (0 * data->transition_factor + (1-data->transition_factor) * angle_polar);
         int32_t ledge = 0;
         int32_t len = 10;
+        geometry->north[0] = tick_point(&t, 0, ledge+r2);
+        geometry->north[1] = point_from_center(&t, angle, ledge+r2-len);
+        geometry->north[2] = point_from_center(&t, -angle, ledge+r2-len);
+    }
+
+    const int32_t margin_letter = 19;
+    const int32_t r0 = r2 - margin_letter;
+    for (int i = 0; i < TICKS_LAYER_NUM_LETTERS; i++) {
+        geometry->letters[i] = tick_point(&t, letter_tick_idx(i), r0);
+    }
+
+    return geometry;
+}
+
+static void ticks_layer_update_proc(Layer *layer, GContext *ctx) {
+    TicksLayer *ticks_layer = (TicksLayer *)layer;
+    const TicksLayerGeometry *geometry = ticks_layer_update_geometry(ticks_layer, layer_get_bounds(layer));
+
+    graphics_context_set_stroke_color(ctx, GColorWhite);
+    graphics_context_set_fill_color(ctx, GColorWhite);
+
+    // draw ticks
+    for (int i = 0; i < TICKS_LAYER_NUM_TICKS; i++) {
+        #if defined(PBL_COLOR)
+          if(tick_len(ticks_layer, i) == 2) {
+            graphics_context_set_stroke_color(ctx, GColorDarkGray);
+          }
+          else {
+            graphics_context_set_stroke_color(ctx, GColorWhite);
+          }
+        #endif
+
+        graphics_draw_line(ctx, geometry->tick_inner[i], geometry->tick_outer[i]);
+    }
+
+    // draw north
+    if(geometry->has_north) {
         GPathInfo points = {
                 3,
                 (GPoint[3]) {
-                    point_from_center(ticks_layer, 0, ledge+r2),
-                    point_from_center(ticks_layer, angle, ledge+r2-len),
-                    point_from_center(ticks_layer, -angle, ledge+r2-len),
+                    geometry->north[0],
+                    geometry->north[1],
+                    geometry->north[2],
                 },
         };
         GPath *path = gpath_create(&points);
@@ -135,22 +238,19 @@ static void ticks_layer_update_proc(Layer *layer, GContext *ctx) {
 
         typedef struct {
             char* caption;
-            int32_t angle;
             GFont font;
             GColor color;
         } point_helper;
 
         GFont font_large = fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD);
-        point_helper point_helpers[] = {
-                {"N", TRIG_MAX_ANGLE * 0 / 8, font_large, PBL_IF_COLOR_ELSE(GColorRed, GColorWhite)},
-                {"E", TRIG_MAX_ANGLE * 2 / 8, font_large, GColorWhite},
-                {"S", TRIG_MAX_ANGLE * 4 / 8, font_large, GColorWhite},
-                {"W", TRIG_MAX_ANGLE * 6 / 8, font_large, GColorWhite},
+        point_helper point_helpers[TICKS_LAYER_NUM_LETTERS] = {
+                {"N", font_large, PBL_IF_COLOR_ELSE(GColorRed, GColorWhite)},
+                {"E", font_large, GColorWhite},
+                {"S", font_large, GColorWhite},
+                {"W", font_large, GColorWhite},
         };
 
         {
-            int32_t margin_letter = 19;
-            const int32_t r0 = r2 - margin_letter;
             const int16_t vertical_text_offset = 3;
 
             for (uint32_t i = 0; i < ARRAY_LENGTH(point_helpers); i++) {
@@ -160,7 +260,7 @@ static void ticks_layer_update_proc(Layer *layer, GContext *ctx) {
                 char const *caption = point_helpers[i].caption;
                 const GFont font = point_helpers[i].font;
 
-                const GPoint p = point_from_center(ticks_layer, point_helpers[i].angle, r0);
+                const GPoint p = geometry->letters[i];
 
                 GSize size = graphics_text_layout_get_content_size(caption, font, GRect(0, 0, 100, 100), GTextOverflowModeFill, GTextAlignmentCenter);
                 GRect text_box = (GRect) {{(int16_t) (p.x - size.w / 2), (int16_t) (p.y - size.h / 2 - vertical_text_offset)}, size};
@@ -173,7 +273,9 @@ static void ticks_layer_update_proc(Layer *layer, GContext *ctx) {
 }
 
 TicksLayer *ticks_layer_create(GRect frame) {
+    init_tick_unit_vectors();
     Layer *result = layer_create_with_data(frame, sizeof(TicksLayerData));
+    layer_get_ticks_data(result)->geometry.valid = false;
 
     layer_set_update_proc(result, ticks_layer_update_proc);
     return (TicksLayer *)result;
@@ -184,12 +286,21 @@ void ticks_layer_destroy(TicksLayer *layer) {
 }
 
 void ticks_layer_set_angle(TicksLayer* layer, int32_t angle) {
-    ticks_layer_get_ticks_data(layer)->angle = angle;
+    TicksLayerData *data = ticks_layer_get_ticks_data(layer);
+    if (data->angle == angle) return;
+    data->angle = angle;
     layer_mark_dirty(ticks_layer_get_layer(layer));
 }
 
+int32_t ticks_layer_get_angle(TicksLayer *layer) {
+    return ticks_layer_get_ticks_data(layer)->angle;
+}
+
 void ticks_layer_set_transition_factor(TicksLayer *layer, float factor) {
-    ticks_layer_get_ticks_data(layer)->transition_factor = MIN(MAX(0, factor), 1);
+    TicksLayerData *data = ticks_layer_get_ticks_data(layer);
+    factor = MIN(MAX(0, factor), 1);
+    if (data->transition_factor == factor) return;
+    data->transition_factor = factor;
 
     GRect frame = layer_get_bounds(ticks_layer_get_layer(layer));
     GRect newframe;
@@ -207,3 +318,28 @@ void ticks_layer_set_transition_factor(TicksLayer *layer, float factor) {
 float ticks_layer_get_transition_factor(TicksLayer *layer) {
     return ticks_layer_get_ticks_data(layer)->transition_factor;
 }
+
+int32_t ticks_layer_get_displacement(TicksLayer *layer, int32_t angle, float transition_factor) {
+    const TicksLayerData *data = ticks_layer_get_ticks_data(layer);
+    transition_factor = MIN(MAX(0, transition_factor), 1);
+    // the north triangle and the frame of the layer switch at these, see ticks_layer_update_proc()
+    const bool switches_mode = transition_factor != data->transition_factor &&
+            (transition_factor == 1 || data->transition_factor == 1 || is_polar(transition_factor) != is_polar(data->transition_factor));
+
+    const GRect bounds = layer_get_bounds(ticks_layer_get_layer(layer));
+    const int32_t radius = ticks_layer_outer_radius(bounds);
+    const int32_t band_width = bounds.size.w + bounds.size.h;
+
+    int32_t delta = (angle - data->angle) % TRIG_MAX_ANGLE;
+    while(delta > +TRIG_MAX_ANGLE / 2)delta -= TRIG_MAX_ANGLE;
+    while(delta < -TRIG_MAX_ANGLE / 2)delta += TRIG_MAX_ANGLE;
+    // a turn moves the rim by its circumference while polar and by the band's width while cartesian
+    const int32_t rim_length = MAX(2 * radius * 355 / 113, band_width);
+    const int32_t angle_displacement = (int32_t) ((int64_t) (delta < 0 ? -delta : delta) * rim_length / TRIG_MAX_ANGLE);
+
+    // blending moves each point at most from its polar to its cartesian position, which are less than a band's width apart
+    const float factor_delta = transition_factor - data->transition_factor;
+    const int32_t transition_displacement = (int32_t) ((factor_delta < 0 ? -factor_delta : factor_delta) * band_width);
+
+    return MAX(angle_displacement + transition_displacement, switches_mode ? 1 : 0);
+}
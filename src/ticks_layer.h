@@ -1,3 +1,5 @@
+#pragma once
+
 #include "pebble.h"
 
 typedef struct TicksLayer TicksLayer;
@@ -8,6 +10,11 @@ TicksLayer *ticks_layer_create(GRect frame);
 void ticks_layer_destroy(TicksLayer *layer);
 
 void ticks_layer_set_angle(TicksLayer* layer, int32_t angle);
+int32_t ticks_layer_get_angle(TicksLayer *layer);
 
 float ticks_layer_get_transition_factor(TicksLayer *layer);
 void ticks_layer_set_transition_factor(TicksLayer *layer, float factor);
+
+// how many whole pixels the farthest moving point of the rim would move if the layer showed angle and factor instead
+// 0 if setting them wouldn't change what's on screen
+int32_t ticks_layer_get_displacement(TicksLayer *layer, int32_t angle, float factor);